@@ -1,14 +1,15 @@
 from __future__ import annotations
-import base64, io, threading, itertools
-from fastapi import FastAPI, HTTPException, Query
-from fastapi.responses import StreamingResponse
+import base64, io, os, threading, itertools, struct
+from fastapi import FastAPI, HTTPException, Query, Request
+from fastapi.responses import StreamingResponse, Response
+from starlette.concurrency import run_in_threadpool
 from PIL import Image
 import numpy as np
 from typing import List, Dict, Tuple
 
 # 现有导入（保留）
 from inference.opencv_model import detect_bboxes, DetectConfig
-from schemas import AnalyzeViewportReq, AnalyzeViewportResp, Box
+from schemas import AnalyzeViewportReq, AnalyzeViewportResp, Box, RegionBatchReq
 
 # 因为要处理WSI图像，所以只用Opensilde，不用其他，此处做检查
 try:
@@ -31,17 +32,23 @@ def analyze_viewport(req: AnalyzeViewportReq):
     pil_img = Image.open(io.BytesIO(data)).convert("RGB")
     rgb = np.array(pil_img)
     bgr = rgb[:, :, ::-1]
+    out_boxes = _analyze(bgr, req.slide_id, req.level, req.origin_x, req.origin_y)
+    h, w = rgb.shape[:2]
+    return AnalyzeViewportResp(image_size=(int(w), int(h)), boxes=out_boxes)
+
+def _analyze(bgr: np.ndarray, slide_id, level, origin_x, origin_y) -> List[Box]:
     boxes = detect_bboxes(bgr, DetectConfig())
-    level = int(req.level) if req.level is not None else 0
-    origin_x = float(req.origin_x or 0.0)
-    origin_y = float(req.origin_y or 0.0)
+    level = int(level) if level is not None else 0
+    origin_x = float(origin_x or 0.0)
+    origin_y = float(origin_y or 0.0)
     downsample = 1.0
 
-    if req.slide_id is not None:
+    if slide_id is not None:
         with _LOCK:
-            meta = _META.get(req.slide_id)
+            meta = _META.get(slide_id)
         if meta is None:
-            raise HTTPException(status_code=404, detail="slide 未打开或已关闭，请先调用 /open_wsi")
+            # 用 410 而不是 404：前端把 404 视为接口不存在并换用 JSON 接口重发
+            raise HTTPException(status_code=410, detail="slide 未打开或已关闭，请先调用 /open_wsi")
         downsamples = meta.get("level_downsamples") or []
         if not (0 <= level < len(downsamples)):
             raise HTTPException(status_code=400, detail="level 超出范围，无法换算到 level0")
@@ -60,8 +67,59 @@ def analyze_viewport(req: AnalyzeViewportReq):
         out_boxes.append(
             Box(x=lx, y=ly, w=lw, h=lh, label="tumor", score=float(score))
         )
-    h, w = rgb.shape[:2]
-    return AnalyzeViewportResp(image_size=(int(w), int(h)), boxes=out_boxes)
+    return out_boxes
+
+# 二进制识别接口：省掉 PNG + base64 + JSON 的往返编码。
+# 请求体 = 头部 <4sBxxxIIiidd（magic "WIQ1", 像素格式, 宽, 高, slide_id, level, origin_x, origin_y）+ 像素数据；
+# 像素格式 0=紧密 RGB888，1=紧密 BGR888，2=JPEG，3=PNG；slide_id <= 0 表示不换算到 level0。
+# 响应体 = 头部 <4sIIII（magic "WIA1", 图像宽, 高, 框数, 标签数），
+# 随后每个标签 <H 长度 + UTF-8，再是每个框 <ddddfI（x, y, w, h, score, 标签下标）。
+_INFER_REQ = struct.Struct("<4sBxxxIIiidd")
+_INFER_RESP = struct.Struct("<4sIIII")
+_INFER_BOX = struct.Struct("<ddddfI")
+_INFER_LABEL = struct.Struct("<H")
+
+def _decode_pixels(fmt: int, width: int, height: int, payload: bytes) -> np.ndarray:
+    if fmt in (0, 1):
+        if len(payload) != width * height * 3:
+            raise HTTPException(status_code=400, detail="像素数据长度与宽高不符")
+        img = np.frombuffer(payload, dtype=np.uint8).reshape(height, width, 3)
+        return img[:, :, ::-1] if fmt == 0 else img
+    if fmt in (2, 3):
+        try:
+            rgb = np.array(Image.open(io.BytesIO(payload)).convert("RGB"))
+        except Exception as e:
+            raise HTTPException(status_code=400, detail=f"图像解码失败: {e}")
+        return rgb[:, :, ::-1]
+    raise HTTPException(status_code=400, detail=f"未知像素格式 {fmt}")
+
+def _analyze_binary(body: bytes) -> bytes:
+    if len(body) < _INFER_REQ.size:
+        raise HTTPException(status_code=400, detail="请求体过短")
+    magic, fmt, width, height, slide_id, level, origin_x, origin_y = _INFER_REQ.unpack_from(body)
+    if magic != b"WIQ1":
+        raise HTTPException(status_code=400, detail="请求头 magic 不匹配")
+    bgr = _decode_pixels(fmt, width, height, body[_INFER_REQ.size:])
+    boxes = _analyze(np.ascontiguousarray(bgr), slide_id if slide_id > 0 else None, level, origin_x, origin_y)
+
+    labels: Dict[str, int] = {}
+    for b in boxes:
+        labels.setdefault(b.label, len(labels))
+    h, w = bgr.shape[:2]
+    parts = [_INFER_RESP.pack(b"WIA1", w, h, len(boxes), len(labels))]
+    for name in labels:
+        raw = name.encode("utf-8")
+        parts.append(_INFER_LABEL.pack(len(raw)))
+        parts.append(raw)
+    for b in boxes:
+        parts.append(_INFER_BOX.pack(b.x, b.y, b.w, b.h, b.score, labels[b.label]))
+    return b"".join(parts)
+
+@app.post("/analyze_viewport_bin")
+async def analyze_viewport_bin(request: Request):
+    body = await request.body()
+    data = await run_in_threadpool(_analyze_binary, body)
+    return Response(content=data, media_type="application/x-detections")
 
 # ----------------- 新增：WSI 服务 -----------------
 
@@ -96,11 +154,20 @@ def open_wsi(path: str):
         "aperio.AppMag",
     ] if hasattr(openslide, 'PROPERTY_NAME_MPP_X')}
 
+    # 文件大小与修改时间：前端据此区分同一路径下被替换过的切片（磁盘 tile 缓存的标识）
+    try:
+        st = os.stat(path)
+        file_size, file_mtime = st.st_size, st.st_mtime_ns
+    except OSError:
+        file_size, file_mtime = 0, 0
+
     with _LOCK:
         sid = next(_GEN)
         _SLIDES[sid] = slide
         _META[sid] = {
             "path": path,
+            "file_size": file_size,
+            "file_mtime": file_mtime,
             "level_count": level_count,
             "level_dimensions": level_dims,
             "level_downsamples": downsamples,
@@ -108,49 +175,145 @@ def open_wsi(path: str):
         }
     return {"id": sid, **_META[sid]}
 
+# 瓦片传输格式：导航用有损 JPEG/WebP，识别用无损 PNG 或原始 RGB
+_TILE_FORMATS = ("png", "jpeg", "webp", "raw")
+
+def _encode_tile(img: Image.Image, fmt: str, quality: int) -> Response:
+    fmt = fmt.lower()
+    if fmt == "jpg":
+        fmt = "jpeg"
+    if fmt not in _TILE_FORMATS:
+        raise HTTPException(status_code=400, detail=f"不支持的格式 {fmt}，可选：{', '.join(_TILE_FORMATS)}")
+    if fmt == "raw":
+        # 紧密排列的 RGB888，宽高通过响应头传递
+        headers = {"X-Tile-Width": str(img.width), "X-Tile-Height": str(img.height)}
+        return Response(content=img.tobytes(), media_type="application/x-raw-rgb", headers=headers)
+
+    buf = io.BytesIO()
+    if fmt == "jpeg":
+        img.save(buf, format="JPEG", quality=quality, optimize=False)
+    elif fmt == "webp":
+        img.save(buf, format="WEBP", quality=quality, method=0)
+    else:
+        img.save(buf, format="PNG", compress_level=1)
+    return Response(content=buf.getvalue(), media_type=f"image/{fmt}")
+
+def _read_rgb(slide, level: int, x: int, y: int, w: int, h: int) -> Image.Image:
+    # 将 level 坐标换成 level0 坐标读取
+    down = slide.level_downsamples[level]
+    lx = int(round(x * down))
+    ly = int(round(y * down))
+    try:
+        region = slide.read_region((lx, ly), level, (w, h))  # 返回 PIL Image RGBA
+        return region.convert("RGB")
+    except Exception as e:
+        raise HTTPException(status_code=500, detail=f"read_region 失败: {e}")
+
 @app.get("/region")
 def read_region(id: int = Query(...),
                 level: int = Query(0, ge=0),
                 x: int = Query(0, ge=0),
                 y: int = Query(0, ge=0),
                 w: int = Query(..., gt=0),
-                h: int = Query(..., gt=0)):
+                h: int = Query(..., gt=0),
+                format: str = Query("png", description="png / jpeg / webp / raw"),
+                quality: int = Query(85, ge=1, le=100)):
     """
-    读取指定 slide 的 level 层，从 (x,y) 处取 w*h 区域，返回 PNG。
+    读取指定 slide 的 level 层，从 (x,y) 处取 w*h 区域，按 format 编码返回（默认 PNG）。
     坐标是该 level 的坐标（不是 level0 坐标），这样前端换层时不用换算。
     """
     _ensure_openslide()
     with _LOCK:
         slide = _SLIDES.get(id)
     if slide is None:
-        raise HTTPException(status_code=404, detail="无此 slide id，请先 /open_wsi")
+        raise HTTPException(status_code=410, detail="无此 slide id，请先 /open_wsi")
 
     if level < 0 or level >= slide.level_count:
         raise HTTPException(status_code=400, detail="level 越界")
 
-    # 将 level 坐标换成 level0 坐标读取
-    down = slide.level_downsamples[level]
-    lx = int(round(x * down))
-    ly = int(round(y * down))
-    try:
-        region = slide.read_region((lx, ly), level, (w, h))  # 返回 PIL Image RGBA
-        img = region.convert("RGB")
-    except Exception as e:
-        raise HTTPException(status_code=500, detail=f"read_region 失败: {e}")
+    img = _read_rgb(slide, level, x, y, w, h)
+    return _encode_tile(img, format, quality)
 
-    buf = io.BytesIO()
-    img.save(buf, format="PNG")
-    buf.seek(0)
-    return StreamingResponse(buf, media_type="image/png")
+# 批量读取：一个请求取多个区域，响应为长度前缀的帧流，读完一个发一个。
+# 每帧头部为小端 <IIII：index, width, height, length；length 为 0 表示该区域读取失败。
+_BATCH_FRAME = struct.Struct("<IIII")
+# 同一 level 的区域若外接矩形不比各区域面积之和大太多，就一次 read_region 再裁剪
+_BATCH_MERGE_MAX_SIDE = 4096
+_BATCH_MERGE_MAX_WASTE = 1.5
+
+def _batch_groups(regions):
+    by_level: Dict[int, List[int]] = {}
+    for i, r in enumerate(regions):
+        by_level.setdefault(r.level, []).append(i)
+    for level, idxs in by_level.items():
+        x0 = min(regions[i].x for i in idxs)
+        y0 = min(regions[i].y for i in idxs)
+        x1 = max(regions[i].x + regions[i].w for i in idxs)
+        y1 = max(regions[i].y + regions[i].h for i in idxs)
+        union_area = (x1 - x0) * (y1 - y0)
+        area = sum(regions[i].w * regions[i].h for i in idxs)
+        mergeable = (len(idxs) > 1 and x1 - x0 <= _BATCH_MERGE_MAX_SIDE and y1 - y0 <= _BATCH_MERGE_MAX_SIDE
+                     and union_area <= area * _BATCH_MERGE_MAX_WASTE)
+        if mergeable:
+            yield level, (x0, y0, x1 - x0, y1 - y0), idxs
+        else:
+            for i in idxs:
+                yield level, None, [i]
+
+@app.post("/regions")
+def read_regions(req: RegionBatchReq):
+    """
+    批量版 /region：按请求顺序分组读取，编码完一个区域就写出一帧，前端可边收边显示。
+    """
+    _ensure_openslide()
+    with _LOCK:
+        slide = _SLIDES.get(req.id)
+    if slide is None:
+        raise HTTPException(status_code=410, detail="无此 slide id，请先 /open_wsi")
+    for r in req.regions:
+        if r.level >= slide.level_count:
+            raise HTTPException(status_code=400, detail="level 越界")
+    _encode_tile(Image.new("RGB", (1, 1)), req.format, req.quality)  # 先校验格式，出错时还能返回 400
+
+    regions = req.regions
+
+    def frames():
+        for level, bbox, idxs in _batch_groups(regions):
+            try:
+                block = _read_rgb(slide, level, *bbox) if bbox else None
+            except HTTPException:
+                block = None
+            for i in idxs:
+                r = regions[i]
+                try:
+                    if bbox is not None and block is not None:
+                        bx, by = r.x - bbox[0], r.y - bbox[1]
+                        img = block.crop((bx, by, bx + r.w, by + r.h))
+                    else:
+                        img = _read_rgb(slide, r.level, r.x, r.y, r.w, r.h)
+                    payload = _encode_tile(img, req.format, req.quality).body
+                except HTTPException:
+                    yield _BATCH_FRAME.pack(i, r.w, r.h, 0)
+                    continue
+                yield _BATCH_FRAME.pack(i, r.w, r.h, len(payload))
+                yield payload
+
+    fmt = "jpeg" if req.format.lower() == "jpg" else req.format.lower()
+    media = "application/x-raw-rgb" if fmt == "raw" else f"image/{fmt}"
+    return StreamingResponse(frames(), media_type="application/x-tile-stream",
+                             headers={"X-Tile-Content-Type": media})
 
 @app.get("/tile")
 def read_tile(id: int = Query(...),
               level: int = Query(0, ge=0),
               tx: int = Query(..., ge=0),
               ty: int = Query(..., ge=0),
-              tile: int = Query(512, gt=0)):
+              tile: int = Query(512, gt=0),
+              format: str = Query("png"),
+              quality: int = Query(85, ge=1, le=100)):
     """
     DeepZoom 风格：返回 (level, tx, ty) 的 tile（大小 tile*tile）。
     """
-    return read_region(id=id, level=level, x=tx*tile, y=ty*tile, w=tile, h=tile)
+    return read_region(id=id, level=level, x=tx*tile, y=ty*tile, w=tile, h=tile,
+                       format=format, quality=quality)
 
@@ -0,0 +1,67 @@
+# 瓦片传输格式基准：对同一批 tile 统计各格式的 字节数/tile、编码 ms/tile、解码 ms/tile。
+# 用法：python bench_tile_formats.py <slide.svs> [--level 0] [--tiles 64] [--quality 85]
+from __future__ import annotations
+import argparse, io, time
+
+import numpy as np
+from PIL import Image
+
+import openslide
+
+from app import _encode_tile
+
+def _sample_tiles(slide, level: int, count: int, size: int):
+    w, h = slide.level_dimensions[level]
+    down = slide.level_downsamples[level]
+    cols = max(1, w // size)
+    rows = max(1, h // size)
+    # 从中心区域取样，尽量落在组织上
+    cx, cy = cols // 2, rows // 2
+    side = max(1, int(np.ceil(np.sqrt(count))))
+    tiles = []
+    for j in range(side):
+        for i in range(side):
+            tx = min(cols - 1, max(0, cx - side // 2 + i))
+            ty = min(rows - 1, max(0, cy - side // 2 + j))
+            lx, ly = int(tx * size * down), int(ty * size * down)
+            tiles.append(slide.read_region((lx, ly), level, (size, size)).convert("RGB"))
+            if len(tiles) >= count:
+                return tiles
+    return tiles
+
+def _decode(fmt: str, data: bytes, size: int):
+    if fmt == "raw":
+        return np.frombuffer(data, dtype=np.uint8).reshape(size, size, 3)
+    return Image.open(io.BytesIO(data)).convert("RGB")
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("slide")
+    ap.add_argument("--level", type=int, default=0)
+    ap.add_argument("--tiles", type=int, default=64)
+    ap.add_argument("--size", type=int, default=512)
+    ap.add_argument("--quality", type=int, default=85)
+    args = ap.parse_args()
+
+    slide = openslide.OpenSlide(args.slide)
+    tiles = _sample_tiles(slide, args.level, args.tiles, args.size)
+    print(f"{len(tiles)} tiles, level {args.level}, {args.size}px, quality {args.quality}")
+    print(f"{'format':<8}{'KB/tile':>10}{'encode ms':>12}{'decode ms':>12}")
+    for fmt in ("png", "jpeg", "webp", "raw"):
+        total_bytes = 0
+        enc_s = 0.0
+        dec_s = 0.0
+        for img in tiles:
+            t0 = time.perf_counter()
+            data = _encode_tile(img, fmt, args.quality).body
+            t1 = time.perf_counter()
+            _decode(fmt, data, args.size)
+            t2 = time.perf_counter()
+            total_bytes += len(data)
+            enc_s += t1 - t0
+            dec_s += t2 - t1
+        n = len(tiles)
+        print(f"{fmt:<8}{total_bytes / n / 1024:>10.1f}{enc_s / n * 1000:>12.2f}{dec_s / n * 1000:>12.2f}")
+
+if __name__ == "__main__":
+    main()
@@ -26,3 +26,18 @@ class AnalyzeViewportReq(BaseModel):
 class AnalyzeViewportResp(BaseModel):
     image_size: tuple[int, int]
     boxes: List[Box]
+
+
+class RegionSpec(BaseModel):
+    level: int = Field(0, ge=0)
+    x: int = Field(0, ge=0)
+    y: int = Field(0, ge=0)
+    w: int = Field(..., gt=0)
+    h: int = Field(..., gt=0)
+
+
+class RegionBatchReq(BaseModel):
+    id: int = Field(..., ge=1, description="来自 /open_wsi 的 slide id")
+    format: str = Field("png", description="png / jpeg / webp / raw")
+    quality: int = Field(85, ge=1, le=100)
+    regions: List[RegionSpec] = Field(..., min_length=1, max_length=256)
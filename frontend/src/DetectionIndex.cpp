@@ -0,0 +1,138 @@
+#include "DetectionIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// 平均每格的框数；再小格子数会膨胀，再大单格扫描变慢
+constexpr double kBoxesPerCell = 4.0;
+constexpr int kMaxCellsPerAxis = 4096;
+}
+
+void DetectionIndex::clear() {
+    m_result.clear();
+    m_bounds = QRectF();
+    m_cols = m_rows = 0;
+    m_cellStart.clear();
+    m_items.clear();
+}
+
+int DetectionIndex::cellColumn(double x) const {
+    return std::clamp(static_cast<int>(std::floor((x - m_bounds.left()) / m_cellW)), 0, m_cols - 1);
+}
+
+int DetectionIndex::cellRow(double y) const {
+    return std::clamp(static_cast<int>(std::floor((y - m_bounds.top()) / m_cellH)), 0, m_rows - 1);
+}
+
+void DetectionIndex::build(const DetectionResult& result) {
+    clear();
+    if (result.isEmpty()) return;
+
+    m_result = result;
+    const int n = m_result.count();
+    const float* xs = m_result.xData();
+    const float* ys = m_result.yData();
+    const float* ws = m_result.widthData();
+    const float* hs = m_result.heightData();
+    double left = std::numeric_limits<double>::max();
+    double top = std::numeric_limits<double>::max();
+    double right = std::numeric_limits<double>::lowest();
+    double bottom = std::numeric_limits<double>::lowest();
+    for (int i = 0; i < n; ++i) {
+        left = std::min<double>(left, xs[i]);
+        top = std::min<double>(top, ys[i]);
+        right = std::max<double>(right, xs[i] + ws[i]);
+        bottom = std::max<double>(bottom, ys[i] + hs[i]);
+    }
+    m_bounds = QRectF(QPointF(left, top), QPointF(right, bottom));
+    const double width = std::max(1.0, m_bounds.width());
+    const double height = std::max(1.0, m_bounds.height());
+
+    // 按包围盒长宽比分配格子，使格子接近正方形
+    const double cells = std::max(1.0, n / kBoxesPerCell);
+    const double side = std::sqrt(width * height / cells);
+    m_cols = std::clamp(static_cast<int>(std::ceil(width / side)), 1, kMaxCellsPerAxis);
+    m_rows = std::clamp(static_cast<int>(std::ceil(height / side)), 1, kMaxCellsPerAxis);
+    m_cellW = width / m_cols;
+    m_cellH = height / m_rows;
+
+    // 两遍：先计数再填充
+    m_cellStart.fill(0, m_cols * m_rows + 1);
+    for (int i = 0; i < n; ++i) {
+        const int c0 = cellColumn(xs[i]), c1 = cellColumn(xs[i] + ws[i]);
+        const int r0 = cellRow(ys[i]), r1 = cellRow(ys[i] + hs[i]);
+        for (int row = r0; row <= r1; ++row) {
+            for (int col = c0; col <= c1; ++col) {
+                ++m_cellStart[row * m_cols + col + 1];
+            }
+        }
+    }
+    for (int i = 1; i < m_cellStart.size(); ++i) {
+        m_cellStart[i] += m_cellStart[i - 1];
+    }
+    m_items.resize(m_cellStart.back());
+    QVector<int> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (int i = 0; i < n; ++i) {
+        const int c0 = cellColumn(xs[i]), c1 = cellColumn(xs[i] + ws[i]);
+        const int r0 = cellRow(ys[i]), r1 = cellRow(ys[i] + hs[i]);
+        for (int row = r0; row <= r1; ++row) {
+            for (int col = c0; col <= c1; ++col) {
+                m_items[cursor[row * m_cols + col]++] = i;
+            }
+        }
+    }
+}
+
+void DetectionIndex::query(const QRectF& rect, QVector<int>* out) const {
+    if (!out || m_result.isEmpty()) return;
+    const QRectF q = rect.normalized();
+    if (q.right() < m_bounds.left() || q.left() > m_bounds.right() ||
+        q.bottom() < m_bounds.top() || q.top() > m_bounds.bottom()) {
+        return;
+    }
+
+    const float* xs = m_result.xData();
+    const float* ys = m_result.yData();
+    const float* ws = m_result.widthData();
+    const float* hs = m_result.heightData();
+    const int c0 = cellColumn(q.left()), c1 = cellColumn(q.right());
+    const int r0 = cellRow(q.top()), r1 = cellRow(q.bottom());
+    for (int row = r0; row <= r1; ++row) {
+        for (int col = c0; col <= c1; ++col) {
+            const int cell = row * m_cols + col;
+            for (int k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k) {
+                const int i = m_items[k];
+                const double left = xs[i], top = ys[i];
+                if (left + ws[i] < q.left() || left > q.right() || top + hs[i] < q.top() || top > q.bottom()) {
+                    continue;
+                }
+                // 去重：只在交集左上角所在的格子里报告
+                if (cellColumn(std::max(left, q.left())) != col || cellRow(std::max(top, q.top())) != row) {
+                    continue;
+                }
+                out->push_back(i);
+            }
+        }
+    }
+}
+
+int DetectionIndex::hitTest(const QPointF& point, double tolerance) const {
+    const double t = std::max(0.0, tolerance);
+    QVector<int> candidates;
+    query(QRectF(point.x() - t, point.y() - t, 2.0 * t, 2.0 * t), &candidates);
+
+    int best = -1;
+    double bestArea = std::numeric_limits<double>::max();
+    for (int i : std::as_const(candidates)) {
+        const QRectF r = m_result.rect(i);
+        if (!r.adjusted(-t, -t, t, t).contains(point)) continue;
+        const double area = r.width() * r.height();
+        if (area < bestArea) {
+            bestArea = area;
+            best = i;
+        }
+    }
+    return best;
+}
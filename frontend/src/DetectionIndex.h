@@ -0,0 +1,38 @@
+#pragma once
+#include "DetectionResult.h"
+
+#include <QVector>
+#include <QRectF>
+#include <QPointF>
+
+// 检测框的均匀网格索引（level0 坐标）。格子用 CSR 方式紧凑存放：
+// 每格在 m_items 中占一段连续下标。跨格的框在每个覆盖的格子里各登记一次，
+// 查询时只在"框与查询矩形交集左上角所在的格子"里报告，结果不会重复。
+// 坐标直接读 DetectionResult 的列（持有一份共享副本，不复制数据）。
+// 构建后只读，可多线程并发查询。
+class DetectionIndex {
+public:
+    void build(const DetectionResult& result);
+    void clear();
+    bool isEmpty() const { return m_result.isEmpty(); }
+    int size() const { return m_result.count(); }
+    QRectF bounds() const { return m_bounds; }
+
+    // 追加与 rect 相交的框下标（顺序不保证）
+    void query(const QRectF& rect, QVector<int>* out) const;
+    // 包含 point（外扩 tolerance）的框中面积最小的一个；没有返回 -1
+    int hitTest(const QPointF& point, double tolerance = 0.0) const;
+
+private:
+    int cellColumn(double x) const;
+    int cellRow(double y) const;
+
+    DetectionResult m_result;
+    QRectF m_bounds;
+    double m_cellW{1.0};
+    double m_cellH{1.0};
+    int m_cols{0};
+    int m_rows{0};
+    QVector<int> m_cellStart;   // m_cols * m_rows + 1
+    QVector<int> m_items;
+};
@@ -0,0 +1,168 @@
+#include "DetectionLod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr int kMaxLevels = 20;
+
+struct Accum {
+    qint64 key{0};
+    int col{0};
+    int row{0};
+    int count{0};
+    float maxScore{0.0f};
+    double sumX{0.0};
+    double sumY{0.0};
+};
+
+// 按 key 排序后合并相同格子
+QVector<Accum> reduceByKey(QVector<Accum> items) {
+    std::sort(items.begin(), items.end(), [](const Accum& a, const Accum& b) { return a.key < b.key; });
+    QVector<Accum> out;
+    for (const auto& item : std::as_const(items)) {
+        if (!out.isEmpty() && out.back().key == item.key) {
+            Accum& acc = out.back();
+            acc.count += item.count;
+            acc.maxScore = std::max(acc.maxScore, item.maxScore);
+            acc.sumX += item.sumX;
+            acc.sumY += item.sumY;
+        } else {
+            out.push_back(item);
+        }
+    }
+    return out;
+}
+}
+
+void DetectionLod::clear() {
+    m_levels.clear();
+    m_origin = QPointF();
+    m_typicalBoxSize = 0.0;
+}
+
+void DetectionLod::build(const DetectionResult& result) {
+    clear();
+    if (result.isEmpty()) return;
+
+    const int n = result.count();
+    const float* xs = result.xData();
+    const float* ys = result.yData();
+    const float* ws = result.widthData();
+    const float* hs = result.heightData();
+    const float* scores = result.scoreData();
+
+    double left = std::numeric_limits<double>::max();
+    double top = std::numeric_limits<double>::max();
+    double right = std::numeric_limits<double>::lowest();
+    double bottom = std::numeric_limits<double>::lowest();
+    QVector<double> sizes;
+    sizes.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        left = std::min<double>(left, xs[i]);
+        top = std::min<double>(top, ys[i]);
+        right = std::max<double>(right, xs[i] + ws[i]);
+        bottom = std::max<double>(bottom, ys[i] + hs[i]);
+        sizes.push_back(std::max(ws[i], hs[i]));
+    }
+    std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
+    m_typicalBoxSize = std::max(1.0, sizes[sizes.size() / 2]);
+    m_origin = QPointF(left, top);
+    const double extent = std::max({1.0, right - left, bottom - top});
+
+    // 第 0 层：每个框按中心点落格
+    Level base;
+    base.cellSize = m_typicalBoxSize * 2.0;
+    base.cols = static_cast<int>(std::ceil((right - left) / base.cellSize)) + 1;
+    base.rows = static_cast<int>(std::ceil((bottom - top) / base.cellSize)) + 1;
+    QVector<Accum> items;
+    items.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        const double cx = xs[i] + 0.5 * ws[i];
+        const double cy = ys[i] + 0.5 * hs[i];
+        Accum a;
+        a.col = static_cast<int>((cx - left) / base.cellSize);
+        a.row = static_cast<int>((cy - top) / base.cellSize);
+        a.key = static_cast<qint64>(a.row) * base.cols + a.col;
+        a.count = 1;
+        a.maxScore = scores[i];
+        a.sumX = cx;
+        a.sumY = cy;
+        items.push_back(a);
+    }
+
+    Level level = base;
+    for (int depth = 0; depth < kMaxLevels; ++depth) {
+        items = reduceByKey(std::move(items));
+        level.keys.clear();
+        level.cells.clear();
+        level.keys.reserve(items.size());
+        level.cells.reserve(items.size());
+        level.maxCount = 0;
+        for (const auto& a : std::as_const(items)) {
+            level.keys.push_back(a.key);
+            level.cells.push_back(Cell{a.col, a.row, a.count, a.maxScore,
+                                       QPointF(a.sumX / a.count, a.sumY / a.count)});
+            level.maxCount = std::max(level.maxCount, a.count);
+        }
+        m_levels.push_back(level);
+        if (level.cols <= 1 && level.rows <= 1) break;
+        if (level.cellSize > extent) break;
+
+        // 上一层：格子边长翻倍，子格合并到父格
+        Level parent;
+        parent.cellSize = level.cellSize * 2.0;
+        parent.cols = (level.cols + 1) / 2;
+        parent.rows = (level.rows + 1) / 2;
+        for (auto& a : items) {
+            a.col /= 2;
+            a.row /= 2;
+            a.key = static_cast<qint64>(a.row) * parent.cols + a.col;
+        }
+        level = parent;
+    }
+}
+
+double DetectionLod::cellSize(int level) const {
+    if (level < 0 || level >= m_levels.size()) return 0.0;
+    return m_levels[level].cellSize;
+}
+
+QRectF DetectionLod::cellRect(int level, int col, int row) const {
+    const double size = cellSize(level);
+    return QRectF(m_origin.x() + col * size, m_origin.y() + row * size, size, size);
+}
+
+int DetectionLod::maxCount(int level) const {
+    if (level < 0 || level >= m_levels.size()) return 0;
+    return m_levels[level].maxCount;
+}
+
+int DetectionLod::levelForScale(double viewScale, double minScreenPx) const {
+    if (m_levels.isEmpty() || viewScale <= 0.0) return -1;
+    for (int i = 0; i < m_levels.size(); ++i) {
+        if (m_levels[i].cellSize * viewScale >= minScreenPx) return i;
+    }
+    return m_levels.size() - 1;
+}
+
+void DetectionLod::query(int level, const QRectF& worldRect, QVector<Cell>* out) const {
+    if (!out || level < 0 || level >= m_levels.size()) return;
+    const Level& lv = m_levels[level];
+    const QRectF r = worldRect.normalized();
+    const int c0 = std::max(0, static_cast<int>(std::floor((r.left() - m_origin.x()) / lv.cellSize)));
+    const int c1 = std::min(lv.cols - 1, static_cast<int>(std::floor((r.right() - m_origin.x()) / lv.cellSize)));
+    const int r0 = std::max(0, static_cast<int>(std::floor((r.top() - m_origin.y()) / lv.cellSize)));
+    const int r1 = std::min(lv.rows - 1, static_cast<int>(std::floor((r.bottom() - m_origin.y()) / lv.cellSize)));
+    if (c1 < c0 || r1 < r0) return;
+
+    for (int row = r0; row <= r1; ++row) {
+        const qint64 first = static_cast<qint64>(row) * lv.cols + c0;
+        const qint64 last = static_cast<qint64>(row) * lv.cols + c1;
+        auto it = std::lower_bound(lv.keys.cbegin(), lv.keys.cend(), first);
+        for (; it != lv.keys.cend() && *it <= last; ++it) {
+            out->push_back(lv.cells[static_cast<int>(it - lv.keys.cbegin())]);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "DetectionResult.h"
+
+#include <QVector>
+#include <QRectF>
+#include <QPointF>
+
+// 检测结果的多级聚合（level0 坐标）。第 0 层格子边长与典型框大小相当，往上每层边长翻倍。
+// 每格记录框数、最高分与中心点均值，低倍率下据此画聚类符号或密度图，而不是逐框绘制。
+// 每层只保存非空格子，按 (row, col) 排序，查询时逐行二分定位。
+class DetectionLod {
+public:
+    struct Cell {
+        int col{0};
+        int row{0};
+        int count{0};
+        float maxScore{0.0f};
+        QPointF centroid;
+    };
+
+    void build(const DetectionResult& result);
+    void clear();
+    bool isEmpty() const { return m_levels.isEmpty(); }
+
+    // 框边长（取宽高较大者）的中位数
+    double typicalBoxSize() const { return m_typicalBoxSize; }
+    int levelCount() const { return m_levels.size(); }
+    double cellSize(int level) const;
+    QRectF cellRect(int level, int col, int row) const;
+    int maxCount(int level) const;
+
+    // 格子在屏幕上不小于 minScreenPx 的最细一层
+    int levelForScale(double viewScale, double minScreenPx) const;
+    // 与 worldRect 相交的非空格子
+    void query(int level, const QRectF& worldRect, QVector<Cell>* out) const;
+
+private:
+    struct Level {
+        double cellSize{1.0};
+        int cols{0};
+        int rows{0};
+        int maxCount{0};
+        QVector<qint64> keys;   // row * cols + col，升序
+        QVector<Cell> cells;
+    };
+
+    QVector<Level> m_levels;
+    QPointF m_origin;
+    double m_typicalBoxSize{0.0};
+};
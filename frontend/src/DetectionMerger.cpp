@@ -0,0 +1,236 @@
+#include "DetectionMerger.h"
+#include "DetectionIndex.h"
+
+#include <QPair>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+constexpr int kBoxesPerChunk = 4096;
+
+// 按固定块长切分 [0, count)，块数多于一时分到线程池
+template <typename Fn>
+void forEachChunk(int count, Fn fn) {
+    QVector<int> chunks;
+    for (int start = 0; start < count; start += kBoxesPerChunk) {
+        chunks.push_back(start);
+    }
+    if (chunks.size() <= 1) {
+        for (int start : std::as_const(chunks)) fn(start, std::min(count, start + kBoxesPerChunk));
+        return;
+    }
+    QtConcurrent::blockingMap(chunks, [&fn, count](int start) {
+        fn(start, std::min(count, start + kBoxesPerChunk));
+    });
+}
+
+int findRoot(QVector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+} // namespace
+
+void DetectionMerger::addRegion(const QVector<DetBox>& boxes) {
+    const int region = m_regionCount++;
+    m_result.appendBoxes(boxes);
+    m_regions.insert(m_regions.size(), boxes.size(), region);
+}
+
+void DetectionMerger::clear() {
+    m_result.clear();
+    m_regions.clear();
+    m_regionCount = 0;
+}
+
+DetectionResult DetectionMerger::merge(const Options& options) const {
+    const QVector<int> keep = suppress(m_result, options, m_regions);
+    if (keep.size() == m_result.count()) return m_result;
+    return m_result.subset(keep);
+}
+
+QVector<int> DetectionMerger::suppress(const DetectionResult& result, const Options& options,
+                                       const QVector<int>& groups) {
+    const int n = result.count();
+    QVector<int> kept;
+    if (n == 0) return kept;
+
+    // 左上角与分数直接用结果的列；右下角和面积另算成连续数组
+    const float* X0 = result.xData();
+    const float* Y0 = result.yData();
+    const float* W = result.widthData();
+    const float* H = result.heightData();
+    QVector<float> x1(n), y1(n), area(n);
+    for (int i = 0; i < n; ++i) {
+        x1[i] = X0[i] + W[i];
+        y1[i] = Y0[i] + H[i];
+        area[i] = W[i] * H[i];
+    }
+    const QVector<qint32> noLabels = options.perLabel ? QVector<qint32>() : QVector<qint32>(n, 0);
+    const bool useGroups = groups.size() == n;
+    // 并行段只经由裸指针访问，避免 QVector 非 const 访问的 detach 检查
+    const float* X1 = x1.constData();
+    const float* Y1 = y1.constData();
+    const float* A = area.constData();
+    const float* S = result.scoreData();
+    const qint32* L = options.perLabel ? result.labelIdData() : noLabels.constData();
+    const int* G = groups.constData();
+
+    DetectionIndex index;
+    index.build(result);
+
+    const float iouT = std::max(0.0f, options.iouThreshold);
+    const float containT = options.containThreshold > 0.0f ? options.containThreshold
+                                                           : std::numeric_limits<float>::infinity();
+
+    // 第一步：并行找出所有重复对 (i, j)，i < j；每块只写自己的槽位
+    const int chunkCount = (n + kBoxesPerChunk - 1) / kBoxesPerChunk;
+    QVector<QVector<QPair<int, int>>> chunkEdges(chunkCount);
+    QVector<QPair<int, int>>* edgeSlots = chunkEdges.data();
+    forEachChunk(n, [&](int begin, int end) {
+        QVector<QPair<int, int>>& edges = edgeSlots[begin / kBoxesPerChunk];
+        QVector<int> found;
+        QVector<int> cand;
+        QVector<float> cx0, cy0, cx1, cy1, carea;
+        QVector<quint8> dup;
+        for (int i = begin; i < end; ++i) {
+            found.clear();
+            index.query(QRectF(QPointF(X0[i], Y0[i]), QPointF(X1[i], Y1[i])), &found);
+            cand.clear();
+            for (int j : std::as_const(found)) {
+                if (j <= i) continue;
+                if (L[j] != L[i]) continue;
+                if (useGroups && G[i] >= 0 && G[j] == G[i]) continue;
+                cand.push_back(j);
+            }
+            const int m = cand.size();
+            if (m == 0) continue;
+
+            cx0.resize(m); cy0.resize(m); cx1.resize(m); cy1.resize(m); carea.resize(m); dup.resize(m);
+            for (int k = 0; k < m; ++k) {
+                const int j = cand[k];
+                cx0[k] = X0[j]; cy0[k] = Y0[j]; cx1[k] = X1[j]; cy1[k] = Y1[j]; carea[k] = A[j];
+            }
+            // 无分支的批量重叠计算，便于编译器向量化；用乘法比较避免除法
+            const float ax0 = X0[i], ay0 = Y0[i], ax1 = X1[i], ay1 = Y1[i], aArea = A[i];
+            const float* px0 = cx0.constData();
+            const float* py0 = cy0.constData();
+            const float* px1 = cx1.constData();
+            const float* py1 = cy1.constData();
+            const float* pa = carea.constData();
+            quint8* out = dup.data();
+            for (int k = 0; k < m; ++k) {
+                const float iw = std::max(0.0f, std::min(ax1, px1[k]) - std::max(ax0, px0[k]));
+                const float ih = std::max(0.0f, std::min(ay1, py1[k]) - std::max(ay0, py0[k]));
+                const float inter = iw * ih;
+                const float uni = aArea + pa[k] - inter;
+                const float smaller = std::min(aArea, pa[k]);
+                out[k] = quint8((inter > iouT * uni) | (inter > containT * smaller));
+            }
+            for (int k = 0; k < m; ++k) {
+                if (out[k]) edges.push_back(qMakePair(i, cand[k]));
+            }
+        }
+    });
+
+    int edgeCount = 0;
+    for (const auto& edges : std::as_const(chunkEdges)) edgeCount += edges.size();
+    if (edgeCount == 0) {
+        kept.resize(n);
+        std::iota(kept.begin(), kept.end(), 0);
+        return kept;
+    }
+
+    // 第二步：并查集求连通分量，同时建无向邻接表（CSR）
+    QVector<int> parent(n);
+    std::iota(parent.begin(), parent.end(), 0);
+    QVector<int> adjStart(n + 1, 0);
+    for (const auto& edges : std::as_const(chunkEdges)) {
+        for (const auto& e : edges) {
+            const int a = findRoot(parent, e.first);
+            const int b = findRoot(parent, e.second);
+            if (a != b) parent[std::max(a, b)] = std::min(a, b);
+            ++adjStart[e.first + 1];
+            ++adjStart[e.second + 1];
+        }
+    }
+    for (int i = 0; i < n; ++i) adjStart[i + 1] += adjStart[i];
+    QVector<int> adj(adjStart[n]);
+    {
+        QVector<int> cursor(adjStart.begin(), adjStart.end() - 1);
+        for (const auto& edges : std::as_const(chunkEdges)) {
+            for (const auto& e : edges) {
+                adj[cursor[e.first]++] = e.second;
+                adj[cursor[e.second]++] = e.first;
+            }
+        }
+    }
+    chunkEdges.clear();
+
+    // 分量成员按根聚集；孤立框直接保留
+    QVector<char> keep(n, 1);
+    QVector<int> memberStart;
+    QVector<int> members;
+    {
+        QVector<int> slotOf(n, -1);
+        QVector<int> counts;
+        for (int i = 0; i < n; ++i) {
+            if (adjStart[i + 1] == adjStart[i]) continue;
+            const int root = findRoot(parent, i);
+            if (slotOf[root] < 0) {
+                slotOf[root] = counts.size();
+                counts.push_back(0);
+            }
+            ++counts[slotOf[root]];
+        }
+        memberStart.resize(counts.size() + 1);
+        memberStart[0] = 0;
+        for (int c = 0; c < counts.size(); ++c) memberStart[c + 1] = memberStart[c] + counts[c];
+        members.resize(memberStart.back());
+        QVector<int> cursor(memberStart.begin(), memberStart.end() - 1);
+        for (int i = 0; i < n; ++i) {
+            if (adjStart[i + 1] == adjStart[i]) continue;
+            members[cursor[slotOf[findRoot(parent, i)]]++] = i;
+        }
+    }
+
+    // 第三步：各分量内部按分数降序贪心（分数相同按下标），结果与全局贪心 NMS 一致
+    QVector<int> components(memberStart.size() - 1);
+    std::iota(components.begin(), components.end(), 0);
+    int* memberData = members.data();
+    char* keepData = keep.data();
+    const int* starts = memberStart.constData();
+    const int* adjStarts = adjStart.constData();
+    const int* adjData = adj.constData();
+    QtConcurrent::blockingMap(components, [=](int c) {
+        int* first = memberData + starts[c];
+        int* last = memberData + starts[c + 1];
+        std::sort(first, last, [S](int a, int b) {
+            return S[a] != S[b] ? S[a] > S[b] : a < b;
+        });
+        for (int* it = first; it != last; ++it) {
+            const int i = *it;
+            for (int k = adjStarts[i]; k < adjStarts[i + 1]; ++k) {
+                // 邻居都在本分量内；分数更高（或同分下标更小）的已先处理，保留与否已确定
+                const int j = adjData[k];
+                if (keepData[j] && (S[j] > S[i] || (S[j] == S[i] && j < i))) {
+                    keepData[i] = 0;
+                    break;
+                }
+            }
+        }
+    });
+
+    kept.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        if (keep[i]) kept.push_back(i);
+    }
+    return kept;
+}
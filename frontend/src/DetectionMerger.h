@@ -0,0 +1,37 @@
+#pragma once
+#include "DetectionResult.h"
+
+#include <QVector>
+
+// 跨区域检测合并：分块识别时相邻块有重叠，同一目标会被两块各报告一次，
+// 或在块边界被截成半个框。按区域收集检测结果，最后做一次与贪心 NMS 等价的并行抑制：
+// 以 DetectionIndex 分桶找候选，批量计算重叠得到"重复边"，按连通分量分组，
+// 各分量内部按分数贪心保留，分量之间互不影响，可分到线程池并行。
+class DetectionMerger {
+public:
+    struct Options {
+        float iouThreshold{0.5f};
+        // 交集 / 较小框面积，用于识别块边界截断的框；<= 0 关闭
+        float containThreshold{0.8f};
+        // 只在同一标签之间抑制
+        bool perLabel{true};
+    };
+
+    // 追加一个区域的检测结果（level0 坐标）；同一区域内的框互不抑制
+    void addRegion(const QVector<DetBox>& boxes);
+    void clear();
+    int size() const { return m_result.count(); }
+    int regionCount() const { return m_regionCount; }
+
+    DetectionResult merge(const Options& options) const;
+
+    // 返回保留框的下标（升序）。groups 非空时与 result 的框一一对应，
+    // 相同且非负的组号之间不做抑制
+    static QVector<int> suppress(const DetectionResult& result, const Options& options,
+                                 const QVector<int>& groups = QVector<int>());
+
+private:
+    DetectionResult m_result;
+    QVector<int> m_regions;
+    int m_regionCount{0};
+};
@@ -1,50 +1,141 @@
 #include "DetectionResult.h"
-#include <QFile>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QJsonObject>
-
-void DetectionResult::clear(){ m_boxes.clear(); }
-int DetectionResult::count() const { return m_boxes.size(); }
-const QVector<DetBox>& DetectionResult::boxes() const { return m_boxes; }
-void DetectionResult::setBoxes(const QVector<DetBox>& boxes){ m_boxes = boxes; }
-
-bool DetectionResult::saveToJson(const QString& path) const{
-    QJsonObject root;
-    QJsonArray arr;
-    for(const auto& b : m_boxes){
-        QJsonObject o;
-        o["x"]=b.rect.x(); o["y"]=b.rect.y();
-        o["w"]=b.rect.width(); o["h"]=b.rect.height();
-        o["label"]=b.label; o["score"]=b.score;
-        arr.append(o);
+
+#include <algorithm>
+
+namespace {
+template <typename T>
+void appendColumn(QVector<T>& column, const T* data, int n) {
+    const int old = column.size();
+    column.resize(old + n);
+    std::copy(data, data + n, column.begin() + old);
+}
+}
+
+void DetectionResult::clear(){
+    m_mapped = Mapped();
+    m_imageSize = QSize();
+    m_x.clear(); m_y.clear(); m_w.clear(); m_h.clear();
+    m_score.clear();
+    m_labelIds.clear();
+    m_labels.clear();
+    m_labelIndex.clear();
+}
+
+void DetectionResult::reserve(int n){
+    materialize();
+    m_x.reserve(n); m_y.reserve(n); m_w.reserve(n); m_h.reserve(n);
+    m_score.reserve(n);
+    m_labelIds.reserve(n);
+}
+
+void DetectionResult::materialize(){
+    if (!isMapped()) return;
+    const Mapped mapped = m_mapped;
+    const int n = mapped.count;
+    m_mapped = Mapped();
+    m_x = QVector<float>(mapped.x, mapped.x + n);
+    m_y = QVector<float>(mapped.y, mapped.y + n);
+    m_w = QVector<float>(mapped.w, mapped.w + n);
+    m_h = QVector<float>(mapped.h, mapped.h + n);
+    m_score = QVector<float>(mapped.score, mapped.score + n);
+    m_labelIds = QVector<qint32>(mapped.labelIds, mapped.labelIds + n);
+}
+
+int DetectionResult::internLabel(const QString& label){
+    auto it = m_labelIndex.constFind(label);
+    if (it != m_labelIndex.constEnd()) return it.value();
+    const int id = m_labels.size();
+    m_labels.push_back(label);
+    m_labelIndex.insert(label, id);
+    return id;
+}
+
+DetBox DetectionResult::box(int i) const{
+    DetBox b;
+    b.rect = rect(i);
+    b.label = label(i);
+    b.score = score(i);
+    return b;
+}
+
+QVector<DetBox> DetectionResult::toBoxes() const{
+    QVector<DetBox> out;
+    out.reserve(count());
+    for (int i = 0; i < count(); ++i) out.push_back(box(i));
+    return out;
+}
+
+void DetectionResult::setBoxes(const QVector<DetBox>& boxes){
+    clear();
+    appendBoxes(boxes);
+}
+
+void DetectionResult::appendBoxes(const QVector<DetBox>& boxes){
+    reserve(count() + boxes.size());
+    for (const auto& b : boxes) {
+        appendBox(b.rect, static_cast<float>(b.score), b.label);
     }
-    root["image_size"] = QJsonArray{0,0}; // 可按需填充
-    root["boxes"] = arr;
-    QJsonDocument doc(root);
-    QFile f(path);
-    if(!f.open(QIODevice::WriteOnly)) return false;
-    f.write(doc.toJson());
-    return true;
-}
-
-bool DetectionResult::loadFromJson(const QString& path){
-    QFile f(path);
-    if(!f.open(QIODevice::ReadOnly)) return false;
-    auto data = f.readAll();
-    auto doc = QJsonDocument::fromJson(data);
-    if(!doc.isObject()) return false;
-    auto root = doc.object();
-    auto arr = root["boxes"].toArray();
-    m_boxes.clear();
-    for(const auto& it : arr){
-        auto o = it.toObject();
-        DetBox b;
-        b.rect = QRectF(o["x"].toDouble(), o["y"].toDouble(),
-                        o["w"].toDouble(), o["h"].toDouble());
-        b.label = o["label"].toString();
-        b.score = o["score"].toDouble();
-        m_boxes.push_back(b);
+}
+
+void DetectionResult::appendBox(const QRectF& rect, float score, const QString& label){
+    appendBox(rect, score, internLabel(label));
+}
+
+void DetectionResult::appendBox(const QRectF& rect, float score, int labelId){
+    materialize();
+    const QRectF r = rect.normalized();
+    m_x.push_back(static_cast<float>(r.x()));
+    m_y.push_back(static_cast<float>(r.y()));
+    m_w.push_back(static_cast<float>(r.width()));
+    m_h.push_back(static_cast<float>(r.height()));
+    m_score.push_back(score);
+    m_labelIds.push_back(labelId);
+}
+
+void DetectionResult::append(const DetectionResult& other){
+    if (other.isEmpty()) return;
+    if (isEmpty()) {
+        *this = other;
+        return;
+    }
+    materialize();
+    // 标签表不同，先把对方的下标映射到本表
+    QVector<qint32> remap(other.m_labels.size());
+    for (int k = 0; k < other.m_labels.size(); ++k) {
+        remap[k] = internLabel(other.m_labels[k]);
+    }
+    const int n = other.count();
+    appendColumn(m_x, other.xData(), n);
+    appendColumn(m_y, other.yData(), n);
+    appendColumn(m_w, other.widthData(), n);
+    appendColumn(m_h, other.heightData(), n);
+    appendColumn(m_score, other.scoreData(), n);
+    m_labelIds.reserve(m_labelIds.size() + n);
+    const qint32* ids = other.labelIdData();
+    for (int i = 0; i < n; ++i) {
+        m_labelIds.push_back(remap.value(ids[i]));
+    }
+}
+
+DetectionResult DetectionResult::subset(const QVector<int>& indices) const{
+    DetectionResult out;
+    out.m_labels = m_labels;
+    out.m_labelIndex = m_labelIndex;
+    out.m_imageSize = m_imageSize;
+    out.reserve(indices.size());
+    const float* xs = xData();
+    const float* ys = yData();
+    const float* ws = widthData();
+    const float* hs = heightData();
+    const float* scores = scoreData();
+    const qint32* ids = labelIdData();
+    for (int i : indices) {
+        out.m_x.push_back(xs[i]);
+        out.m_y.push_back(ys[i]);
+        out.m_w.push_back(ws[i]);
+        out.m_h.push_back(hs[i]);
+        out.m_score.push_back(scores[i]);
+        out.m_labelIds.push_back(ids[i]);
     }
-    return true;
+    return out;
 }
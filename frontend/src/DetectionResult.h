@@ -1,23 +1,94 @@
 #pragma once
 #include <QVector>
 #include <QString>
+#include <QStringList>
+#include <QHash>
 #include <QRectF>
+#include <QSize>
 
+#include <memory>
+
+class QFile;
+
+// 单个检测框：识别接口逐批返回与界面展示时使用；整体结果以列式存放在 DetectionResult 中
 struct DetBox {
     QRectF rect;
     QString label;
     double score;
 };
 
+// 检测结果的列式存储（level0 坐标）：x/y/w/h 与分数各为一列 float32，
+// 标签驻留在字符串表里、每框只存下标。各列都是隐式共享的 QVector，
+// 复制整个结果只增加引用计数、修改时才真正复制，可按值交给视图与后台线程。
+// 列也可以直接指向内存映射的二进制结果文件（见 DetectionResultIO），第一次修改时才复制到内存。
 class DetectionResult {
 public:
     void clear();
-    int count() const;
-    const QVector<DetBox>& boxes() const;
+    int count() const { return isMapped() ? m_mapped.count : m_x.size(); }
+    bool isEmpty() const { return count() == 0; }
+    void reserve(int n);
+    bool isMapped() const { return m_mapped.file != nullptr; }
+
+    // 切片尺寸（level0），对应 JSON 的 image_size；未知时为空
+    QSize imageSize() const { return m_imageSize; }
+    void setImageSize(const QSize& size) { m_imageSize = size; }
+
+    // 列数据，长度均为 count()；宽高非负
+    const float* xData() const { return isMapped() ? m_mapped.x : m_x.constData(); }
+    const float* yData() const { return isMapped() ? m_mapped.y : m_y.constData(); }
+    const float* widthData() const { return isMapped() ? m_mapped.w : m_w.constData(); }
+    const float* heightData() const { return isMapped() ? m_mapped.h : m_h.constData(); }
+    const float* scoreData() const { return isMapped() ? m_mapped.score : m_score.constData(); }
+    const qint32* labelIdData() const { return isMapped() ? m_mapped.labelIds : m_labelIds.constData(); }
+    const QStringList& labelNames() const { return m_labels; }
+
+    QRectF rect(int i) const { return QRectF(xData()[i], yData()[i], widthData()[i], heightData()[i]); }
+    QPointF center(int i) const {
+        return QPointF(xData()[i] + 0.5f * widthData()[i], yData()[i] + 0.5f * heightData()[i]);
+    }
+    float score(int i) const { return scoreData()[i]; }
+    int labelId(int i) const { return labelIdData()[i]; }
+    QString label(int i) const { return m_labels.value(labelIdData()[i]); }
+    DetBox box(int i) const;
+    QVector<DetBox> toBoxes() const;
+
     void setBoxes(const QVector<DetBox>& boxes);
-    bool saveToJson(const QString& path) const;
-    bool loadFromJson(const QString& path);
+    // 分块识别时逐批追加，已有框的下标保持不变
+    void appendBoxes(const QVector<DetBox>& boxes);
+    void appendBox(const QRectF& rect, float score, const QString& label);
+    // labelId 须来自 internLabel()
+    void appendBox(const QRectF& rect, float score, int labelId);
+    void append(const DetectionResult& other);
+    // 按下标挑出子集，顺序与 indices 一致
+    DetectionResult subset(const QVector<int>& indices) const;
+
+    // 返回标签在字符串表中的下标，新标签追加到表尾
+    int internLabel(const QString& label);
 
 private:
-    QVector<DetBox> m_boxes;
+    friend class DetectionResultIO;
+
+    // 只读映射的列；file 非空时生效，与 m_x 等互斥
+    struct Mapped {
+        std::shared_ptr<QFile> file;
+        const float* x{nullptr};
+        const float* y{nullptr};
+        const float* w{nullptr};
+        const float* h{nullptr};
+        const float* score{nullptr};
+        const qint32* labelIds{nullptr};
+        int count{0};
+    };
+    void materialize();
+
+    Mapped m_mapped;
+    QSize m_imageSize;
+    QVector<float> m_x;
+    QVector<float> m_y;
+    QVector<float> m_w;
+    QVector<float> m_h;
+    QVector<float> m_score;
+    QVector<qint32> m_labelIds;
+    QStringList m_labels;
+    QHash<QString, int> m_labelIndex;
 };
@@ -0,0 +1,689 @@
+#include "DetectionResultIO.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QPromise>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace {
+
+constexpr quint32 kMagic = 0x54454457; // "WDET"
+constexpr int kHeaderSize = 64;
+constexpr int kColumnAlign = 64;
+constexpr int kColumnCount = 6;
+constexpr qint64 kIoChunk = 1 << 20;
+constexpr int kBoxesPerProgress = 16384;
+constexpr int kMaxJsonDepth = 256;
+
+constexpr bool kLittleEndianHost = QSysInfo::ByteOrder == QSysInfo::LittleEndian;
+
+qint64 alignUp(qint64 value, qint64 align) {
+    return (value + align - 1) / align * align;
+}
+
+struct BinaryHeader {
+    quint16 version{0};
+    qint64 count{0};
+    QSize imageSize;
+    quint32 labelCount{0};
+    qint64 columnsOffset{0};
+    qint64 columnStride{0};
+    qint64 labelsOffset{0};
+    qint64 labelsSize{0};
+};
+
+bool parseHeader(const uchar* data, qint64 size, BinaryHeader* header, QString* error) {
+    if (size < kHeaderSize || qFromLittleEndian<quint32>(data) != kMagic) {
+        *error = QStringLiteral("不是检测结果二进制文件");
+        return false;
+    }
+    header->version = qFromLittleEndian<quint16>(data + 4);
+    const quint16 headerSize = qFromLittleEndian<quint16>(data + 6);
+    if (header->version == 0 || header->version > DetectionResultIO::kBinaryVersion) {
+        *error = QStringLiteral("文件格式版本 %1 不受支持（最高支持 %2）")
+                     .arg(header->version).arg(DetectionResultIO::kBinaryVersion);
+        return false;
+    }
+    header->count = qFromLittleEndian<qint64>(data + 8);
+    header->imageSize = QSize(qFromLittleEndian<qint32>(data + 16), qFromLittleEndian<qint32>(data + 20));
+    header->labelCount = qFromLittleEndian<quint32>(data + 24);
+    header->columnsOffset = qFromLittleEndian<qint64>(data + 32);
+    header->columnStride = qFromLittleEndian<qint64>(data + 40);
+    header->labelsOffset = qFromLittleEndian<qint64>(data + 48);
+    header->labelsSize = qFromLittleEndian<qint64>(data + 56);
+
+    // 所有偏移都先确认落在文件内，再去映射的内存里取数
+    const bool valid = headerSize >= kHeaderSize && headerSize <= size
+        && header->count >= 0 && header->count <= std::numeric_limits<int>::max()
+        && header->columnsOffset >= headerSize && header->columnsOffset % 4 == 0
+        && header->columnStride % 4 == 0 && header->columnStride >= header->count * 4
+        && header->columnStride <= (size - header->columnsOffset) / kColumnCount
+        && header->labelsOffset >= headerSize && header->labelsOffset <= size
+        && header->labelsSize >= 0 && header->labelsSize <= size - header->labelsOffset
+        && header->labelCount <= header->labelsSize / 4;
+    if (!valid) {
+        *error = QStringLiteral("文件头损坏或文件被截断");
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+QVector<T> readColumn(const uchar* src, int n) {
+    QVector<T> column(n);
+    for (int i = 0; i < n; ++i) {
+        column[i] = qFromLittleEndian<T>(src + static_cast<qint64>(i) * sizeof(T));
+    }
+    return column;
+}
+
+// 分块写出并报告进度；进度回调返回 false 时停止
+class BlockWriter {
+public:
+    BlockWriter(QIODevice* device, qint64 total, const DetectionResultIO::Progress& progress)
+        : m_device(device), m_total(total), m_progress(progress) {}
+
+    bool write(const char* data, qint64 size) {
+        while (size > 0) {
+            const qint64 chunk = std::min(size, kIoChunk);
+            if (m_device->write(data, chunk) != chunk) return false;
+            m_written += chunk;
+            data += chunk;
+            size -= chunk;
+            if (m_progress && !m_progress(m_written, m_total)) {
+                m_canceled = true;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool pad(qint64 size) {
+        static const QByteArray zeros(kColumnAlign, '\0');
+        while (size > 0) {
+            const qint64 chunk = std::min<qint64>(size, zeros.size());
+            if (!write(zeros.constData(), chunk)) return false;
+            size -= chunk;
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool writeColumn(const T* data, int n, qint64 stride) {
+        const qint64 bytes = static_cast<qint64>(n) * sizeof(T);
+        if constexpr (kLittleEndianHost) {
+            if (!write(reinterpret_cast<const char*>(data), bytes)) return false;
+        } else {
+            constexpr int step = static_cast<int>(kIoChunk / sizeof(T));
+            QByteArray buffer;
+            for (int begin = 0; begin < n; begin += step) {
+                const int end = std::min(n, begin + step);
+                buffer.resize(static_cast<qsizetype>(end - begin) * sizeof(T));
+                uchar* out = reinterpret_cast<uchar*>(buffer.data());
+                for (int i = begin; i < end; ++i) {
+                    qToLittleEndian<T>(data[i], out + static_cast<qint64>(i - begin) * sizeof(T));
+                }
+                if (!write(buffer.constData(), buffer.size())) return false;
+            }
+        }
+        return pad(stride - bytes);
+    }
+
+    bool canceled() const { return m_canceled; }
+
+private:
+    QIODevice* m_device;
+    qint64 m_total;
+    qint64 m_written{0};
+    const DetectionResultIO::Progress& m_progress;
+    bool m_canceled{false};
+};
+
+// 按 JSON 字符串转义并加引号，输出 UTF-8
+QByteArray jsonString(const QString& text) {
+    static const char hex[] = "0123456789abcdef";
+    const QByteArray utf8 = text.toUtf8();
+    QByteArray out;
+    out.reserve(utf8.size() + 2);
+    out += '"';
+    for (char ch : utf8) {
+        const uchar c = static_cast<uchar>(ch);
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xf];
+            } else {
+                out += ch;
+            }
+        }
+    }
+    out += '"';
+    return out;
+}
+
+// float32 的最短可还原写法：先试 7 位有效数字，不够再用 9 位
+void appendNumber(QByteArray& out, float value) {
+    if (!std::isfinite(value)) {
+        out += '0';
+        return;
+    }
+    QByteArray text = QByteArray::number(static_cast<double>(value), 'g', 7);
+    if (text.toFloat() != value) {
+        text = QByteArray::number(static_cast<double>(value), 'g', 9);
+    }
+    out += text;
+}
+
+void appendUtf8(QByteArray& out, uint code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xc0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xe0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+// 按块读取的 JSON 词法扫描器，只提供结果文件需要的几种操作；
+// 字符串以原始 UTF-8 字节返回，由调用方决定是否转成 QString
+class JsonScanner {
+public:
+    explicit JsonScanner(QIODevice* device) : m_device(device) {}
+
+    qint64 position() const { return m_base + (m_pos - m_buffer.constData()); }
+
+    int peek() {
+        if (m_pos == m_end && !fill()) return -1;
+        return static_cast<uchar>(*m_pos);
+    }
+
+    int get() {
+        const int c = peek();
+        if (c >= 0) ++m_pos;
+        return c;
+    }
+
+    void skipSpace() {
+        for (int c = peek(); c == ' ' || c == '\n' || c == '\r' || c == '\t'; c = peek()) {
+            ++m_pos;
+        }
+    }
+
+    bool consume(char expected) {
+        skipSpace();
+        if (peek() != static_cast<uchar>(expected)) return false;
+        ++m_pos;
+        return true;
+    }
+
+    bool readString(QByteArray* out) {
+        out->clear();
+        if (!consume('"')) return false;
+        for (;;) {
+            if (m_pos == m_end && !fill()) return false;
+            // 连续的普通字符整段复制
+            const char* start = m_pos;
+            while (m_pos != m_end && *m_pos != '"' && *m_pos != '\\') ++m_pos;
+            out->append(start, m_pos - start);
+            if (m_pos == m_end) continue;
+            if (*m_pos++ == '"') return true;
+            const int esc = get();
+            switch (esc) {
+            case '"': case '\\': case '/': out->append(static_cast<char>(esc)); break;
+            case 'b': out->append('\b'); break;
+            case 'f': out->append('\f'); break;
+            case 'n': out->append('\n'); break;
+            case 'r': out->append('\r'); break;
+            case 't': out->append('\t'); break;
+            case 'u': {
+                uint code = 0;
+                if (!readHex4(&code)) return false;
+                if (code >= 0xd800 && code < 0xdc00) {
+                    uint low = 0;
+                    if (get() != '\\' || get() != 'u' || !readHex4(&low) || low < 0xdc00 || low >= 0xe000) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                appendUtf8(*out, code);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+    }
+
+    bool readNumber(double* out) {
+        skipSpace();
+        char text[64];
+        int length = 0;
+        for (int c = peek(); c >= 0 && (std::isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E');
+             c = peek()) {
+            if (length == static_cast<int>(sizeof(text))) return false;
+            text[length++] = static_cast<char>(c);
+            ++m_pos;
+        }
+        if (length == 0) return false;
+        bool ok = false;
+        *out = QByteArray::fromRawData(text, length).toDouble(&ok);
+        return ok;
+    }
+
+    bool skipValue(int depth = 0) {
+        if (depth > kMaxJsonDepth) return false;
+        skipSpace();
+        const int c = peek();
+        if (c == '"') return readString(&m_scratch);
+        if (c == '{' || c == '[') {
+            const char close = c == '{' ? '}' : ']';
+            ++m_pos;
+            if (consume(close)) return true;
+            do {
+                if (c == '{' && (!readString(&m_scratch) || !consume(':'))) return false;
+                if (!skipValue(depth + 1)) return false;
+            } while (consume(','));
+            return consume(close);
+        }
+        if (c == 't' || c == 'f' || c == 'n') {
+            while (std::isalpha(peek())) ++m_pos;
+            return true;
+        }
+        double ignored = 0.0;
+        return readNumber(&ignored);
+    }
+
+private:
+    bool fill() {
+        m_base += m_buffer.size();
+        m_buffer = m_device->read(kIoChunk);
+        m_pos = m_buffer.constData();
+        m_end = m_pos + m_buffer.size();
+        return !m_buffer.isEmpty();
+    }
+
+    bool readHex4(uint* out) {
+        uint value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const int c = get();
+            int digit = -1;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            if (digit < 0) return false;
+            value = value * 16 + static_cast<uint>(digit);
+        }
+        *out = value;
+        return true;
+    }
+
+    QIODevice* m_device;
+    QByteArray m_buffer;
+    const char* m_pos{nullptr};
+    const char* m_end{nullptr};
+    qint64 m_base{0};
+    QByteArray m_scratch;
+};
+
+DetectionResultIO::Progress promiseProgress(QPromise<DetectionResultIO::Outcome>& promise) {
+    return [&promise](qint64 done, qint64 total) {
+        if (total > 0) {
+            promise.setProgressValue(static_cast<int>(std::min(done, total) * DetectionResultIO::kProgressRange / total));
+        }
+        return !promise.isCanceled();
+    };
+}
+
+} // namespace
+
+DetectionResultIO::Format DetectionResultIO::formatForSuffix(const QString& path) {
+    return QFileInfo(path).suffix().compare(QLatin1String("wdet"), Qt::CaseInsensitive) == 0 ? Format::Binary
+                                                                                              : Format::Json;
+}
+
+DetectionResultIO::Format DetectionResultIO::detectFormat(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return formatForSuffix(path);
+    const QByteArray head = file.read(4);
+    if (head.size() < 4) return formatForSuffix(path);
+    return qFromLittleEndian<quint32>(head.constData()) == kMagic ? Format::Binary : Format::Json;
+}
+
+DetectionResultIO::Outcome DetectionResultIO::readJson(const QString& path, const Progress& progress) {
+    Outcome out;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        out.error = QStringLiteral("无法打开文件：%1").arg(path);
+        return out;
+    }
+    const qint64 total = file.size();
+    JsonScanner scanner(&file);
+    DetectionResult& result = out.result;
+    // 同一标签的原始字节只转换、查表一次
+    QHash<QByteArray, int> labelIds;
+    QByteArray key;
+    QByteArray text;
+    bool sawBoxes = false;
+
+    const auto fail = [&out, &scanner]() {
+        out.result.clear();
+        out.error = QStringLiteral("JSON 格式错误（第 %1 字节附近）").arg(scanner.position());
+        return out;
+    };
+
+    const auto readBox = [&]() {
+        if (!scanner.consume('{')) return false;
+        double x = 0.0, y = 0.0, w = 0.0, h = 0.0, score = 0.0;
+        text.clear();
+        if (!scanner.consume('}')) {
+            do {
+                if (!scanner.readString(&key) || !scanner.consume(':')) return false;
+                bool ok = true;
+                if (key == "x") ok = scanner.readNumber(&x);
+                else if (key == "y") ok = scanner.readNumber(&y);
+                else if (key == "w") ok = scanner.readNumber(&w);
+                else if (key == "h") ok = scanner.readNumber(&h);
+                else if (key == "score") ok = scanner.readNumber(&score);
+                else if (key == "label") ok = scanner.readString(&text);
+                else ok = scanner.skipValue();
+                if (!ok) return false;
+            } while (scanner.consume(','));
+            if (!scanner.consume('}')) return false;
+        }
+        auto it = labelIds.constFind(text);
+        if (it == labelIds.constEnd()) {
+            it = labelIds.insert(text, result.internLabel(QString::fromUtf8(text)));
+        }
+        result.appendBox(QRectF(x, y, w, h), static_cast<float>(score), it.value());
+        return true;
+    };
+
+    if (!scanner.consume('{')) return fail();
+    if (!scanner.consume('}')) {
+        do {
+            if (!scanner.readString(&key) || !scanner.consume(':')) return fail();
+            if (key == "boxes") {
+                sawBoxes = true;
+                if (!scanner.consume('[')) return fail();
+                if (scanner.consume(']')) continue;
+                do {
+                    if (!readBox()) return fail();
+                    if (progress && result.count() % kBoxesPerProgress == 0 && !progress(scanner.position(), total)) {
+                        out.result.clear();
+                        out.canceled = true;
+                        return out;
+                    }
+                } while (scanner.consume(','));
+                if (!scanner.consume(']')) return fail();
+            } else if (key == "image_size") {
+                double size[2] = {0.0, 0.0};
+                int n = 0;
+                if (!scanner.consume('[')) return fail();
+                if (!scanner.consume(']')) {
+                    do {
+                        double v = 0.0;
+                        if (!scanner.readNumber(&v)) return fail();
+                        if (n < 2) size[n] = v;
+                        ++n;
+                    } while (scanner.consume(','));
+                    if (!scanner.consume(']')) return fail();
+                }
+                if (n == 2) {
+                    result.setImageSize(QSize(static_cast<int>(size[0]), static_cast<int>(size[1])));
+                }
+            } else if (!scanner.skipValue()) {
+                return fail();
+            }
+        } while (scanner.consume(','));
+        if (!scanner.consume('}')) return fail();
+    }
+    if (!sawBoxes) {
+        out.result.clear();
+        out.error = QStringLiteral("缺少 boxes 字段");
+        return out;
+    }
+    if (progress) progress(total, total);
+    out.ok = true;
+    return out;
+}
+
+DetectionResultIO::Outcome DetectionResultIO::writeJson(const DetectionResult& result, const QString& path,
+                                                        const Progress& progress) {
+    Outcome out;
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        out.error = QStringLiteral("无法写入文件：%1").arg(path);
+        return out;
+    }
+
+    QVector<QByteArray> labels;
+    for (const QString& name : result.labelNames()) {
+        labels.push_back(jsonString(name));
+    }
+    const QByteArray emptyLabel = jsonString(QString());
+
+    const int n = result.count();
+    const float* xs = result.xData();
+    const float* ys = result.yData();
+    const float* ws = result.widthData();
+    const float* hs = result.heightData();
+    const float* scores = result.scoreData();
+    const qint32* ids = result.labelIdData();
+    const QSize imageSize = result.imageSize();
+
+    QByteArray buffer;
+    buffer.reserve(kIoChunk + 4096);
+    buffer += "{\n  \"image_size\": [";
+    buffer += QByteArray::number(imageSize.isValid() ? imageSize.width() : 0);
+    buffer += ", ";
+    buffer += QByteArray::number(imageSize.isValid() ? imageSize.height() : 0);
+    buffer += "],\n  \"boxes\": [";
+    for (int i = 0; i < n; ++i) {
+        buffer += i ? ",\n    {\"x\": " : "\n    {\"x\": ";
+        appendNumber(buffer, xs[i]);
+        buffer += ", \"y\": ";
+        appendNumber(buffer, ys[i]);
+        buffer += ", \"w\": ";
+        appendNumber(buffer, ws[i]);
+        buffer += ", \"h\": ";
+        appendNumber(buffer, hs[i]);
+        buffer += ", \"label\": ";
+        buffer += ids[i] >= 0 && ids[i] < labels.size() ? labels[ids[i]] : emptyLabel;
+        buffer += ", \"score\": ";
+        appendNumber(buffer, scores[i]);
+        buffer += '}';
+        if (buffer.size() >= kIoChunk) {
+            if (file.write(buffer) != buffer.size()) {
+                out.error = QStringLiteral("写入失败：%1").arg(file.errorString());
+                file.cancelWriting();
+                return out;
+            }
+            buffer.resize(0);
+            if (progress && !progress(i + 1, n)) {
+                file.cancelWriting();
+                out.canceled = true;
+                return out;
+            }
+        }
+    }
+    buffer += n ? "\n  ]\n}\n" : "]\n}\n";
+    if (file.write(buffer) != buffer.size() || !file.commit()) {
+        out.error = QStringLiteral("写入失败：%1").arg(file.errorString());
+        return out;
+    }
+    if (progress) progress(n, n);
+    out.ok = true;
+    return out;
+}
+
+DetectionResultIO::Outcome DetectionResultIO::mapBinary(const QString& path) {
+    Outcome out;
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        out.error = QStringLiteral("无法打开文件：%1").arg(path);
+        return out;
+    }
+    const qint64 size = file->size();
+    const uchar* mapped = size >= kHeaderSize ? file->map(0, size) : nullptr;
+    // 映射失败（如部分网络文件系统）时整体读入
+    QByteArray contents;
+    const uchar* data = mapped;
+    if (!data) {
+        contents = file->readAll();
+        data = reinterpret_cast<const uchar*>(contents.constData());
+    }
+    BinaryHeader header;
+    if (!parseHeader(data, mapped ? size : contents.size(), &header, &out.error)) return out;
+
+    DetectionResult& result = out.result;
+    result.setImageSize(header.imageSize);
+    const uchar* labels = data + header.labelsOffset;
+    const uchar* labelsEnd = labels + header.labelsSize;
+    for (quint32 k = 0; k < header.labelCount; ++k) {
+        if (labelsEnd - labels < 4) {
+            out.error = QStringLiteral("标签表损坏");
+            return out;
+        }
+        const quint32 length = qFromLittleEndian<quint32>(labels);
+        labels += 4;
+        if (static_cast<quint64>(labelsEnd - labels) < length) {
+            out.error = QStringLiteral("标签表损坏");
+            return out;
+        }
+        const QString name = QString::fromUtf8(reinterpret_cast<const char*>(labels), length);
+        labels += length;
+        // 下标必须与文件一致，重复的名字也照样占位
+        result.m_labels.push_back(name);
+        if (!result.m_labelIndex.contains(name)) result.m_labelIndex.insert(name, static_cast<int>(k));
+    }
+
+    const int n = static_cast<int>(header.count);
+    const auto column = [&](int k) { return data + header.columnsOffset + k * header.columnStride; };
+    if (mapped && kLittleEndianHost) {
+        // 列直接指向映射的内存，打开与框数无关
+        DetectionResult::Mapped& columns = result.m_mapped;
+        columns.file = file;
+        columns.x = reinterpret_cast<const float*>(column(0));
+        columns.y = reinterpret_cast<const float*>(column(1));
+        columns.w = reinterpret_cast<const float*>(column(2));
+        columns.h = reinterpret_cast<const float*>(column(3));
+        columns.score = reinterpret_cast<const float*>(column(4));
+        columns.labelIds = reinterpret_cast<const qint32*>(column(5));
+        columns.count = n;
+    } else {
+        result.m_x = readColumn<float>(column(0), n);
+        result.m_y = readColumn<float>(column(1), n);
+        result.m_w = readColumn<float>(column(2), n);
+        result.m_h = readColumn<float>(column(3), n);
+        result.m_score = readColumn<float>(column(4), n);
+        result.m_labelIds = readColumn<qint32>(column(5), n);
+    }
+    out.ok = true;
+    return out;
+}
+
+DetectionResultIO::Outcome DetectionResultIO::writeBinary(const DetectionResult& result, const QString& path,
+                                                          const Progress& progress) {
+    Outcome out;
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        out.error = QStringLiteral("无法写入文件：%1").arg(path);
+        return out;
+    }
+
+    QByteArray labels;
+    for (const QString& name : result.labelNames()) {
+        const QByteArray utf8 = name.toUtf8();
+        uchar length[4];
+        qToLittleEndian<quint32>(static_cast<quint32>(utf8.size()), length);
+        labels.append(reinterpret_cast<const char*>(length), 4);
+        labels += utf8;
+    }
+
+    const int n = result.count();
+    const qint64 stride = alignUp(static_cast<qint64>(n) * 4, kColumnAlign);
+    const qint64 columnsOffset = kHeaderSize;
+    const qint64 labelsOffset = columnsOffset + kColumnCount * stride;
+    const QSize imageSize = result.imageSize();
+
+    QByteArray header(kHeaderSize, '\0');
+    uchar* h = reinterpret_cast<uchar*>(header.data());
+    qToLittleEndian<quint32>(kMagic, h);
+    qToLittleEndian<quint16>(kBinaryVersion, h + 4);
+    qToLittleEndian<quint16>(kHeaderSize, h + 6);
+    qToLittleEndian<qint64>(n, h + 8);
+    qToLittleEndian<qint32>(imageSize.isValid() ? imageSize.width() : 0, h + 16);
+    qToLittleEndian<qint32>(imageSize.isValid() ? imageSize.height() : 0, h + 20);
+    qToLittleEndian<quint32>(static_cast<quint32>(result.labelNames().size()), h + 24);
+    qToLittleEndian<qint64>(columnsOffset, h + 32);
+    qToLittleEndian<qint64>(stride, h + 40);
+    qToLittleEndian<qint64>(labelsOffset, h + 48);
+    qToLittleEndian<qint64>(labels.size(), h + 56);
+
+    BlockWriter writer(&file, labelsOffset + labels.size(), progress);
+    const bool written = writer.write(header.constData(), header.size())
+        && writer.writeColumn(result.xData(), n, stride)
+        && writer.writeColumn(result.yData(), n, stride)
+        && writer.writeColumn(result.widthData(), n, stride)
+        && writer.writeColumn(result.heightData(), n, stride)
+        && writer.writeColumn(result.scoreData(), n, stride)
+        && writer.writeColumn(result.labelIdData(), n, stride)
+        && writer.write(labels.constData(), labels.size());
+    if (!written) {
+        file.cancelWriting();
+        out.canceled = writer.canceled();
+        if (!out.canceled) out.error = QStringLiteral("写入失败：%1").arg(file.errorString());
+        return out;
+    }
+    if (!file.commit()) {
+        out.error = QStringLiteral("写入失败：%1").arg(file.errorString());
+        return out;
+    }
+    out.ok = true;
+    return out;
+}
+
+QFuture<DetectionResultIO::Outcome> DetectionResultIO::loadAsync(const QString& path) {
+    return QtConcurrent::run([path](QPromise<Outcome>& promise) {
+        promise.setProgressRange(0, kProgressRange);
+        Outcome out = detectFormat(path) == Format::Binary ? mapBinary(path) : readJson(path, promiseProgress(promise));
+        promise.setProgressValue(kProgressRange);
+        promise.addResult(std::move(out));
+    });
+}
+
+QFuture<DetectionResultIO::Outcome> DetectionResultIO::saveAsync(const DetectionResult& result, const QString& path) {
+    return QtConcurrent::run([result, path](QPromise<Outcome>& promise) {
+        promise.setProgressRange(0, kProgressRange);
+        const Progress progress = promiseProgress(promise);
+        Outcome out = formatForSuffix(path) == Format::Binary ? writeBinary(result, path, progress)
+                                                              : writeJson(result, path, progress);
+        promise.setProgressValue(kProgressRange);
+        promise.addResult(std::move(out));
+    });
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "DetectionResult.h"
+
+#include <QFuture>
+#include <QString>
+
+#include <functional>
+
+// 检测结果的文件读写，都可以在后台线程调用。
+// JSON 与 shared/result_schema.json 一致，按块流式读写，不在内存中构造整个 QJsonDocument；
+// 二进制格式（.wdet）按列存放 little-endian 数据，打开时只校验文件头并做内存映射，不逐框解析。
+//
+// .wdet 布局（版本 1，所有整数 little-endian）：
+//   0  "WDET"            4  quint16 版本   6  quint16 文件头长度(64)
+//   8  qint64 框数       16 qint32 切片宽  20 qint32 切片高
+//   24 quint32 标签数    28 quint32 保留
+//   32 qint64 列起点     40 qint64 列间距（64 字节对齐）
+//   48 qint64 标签表起点 56 qint64 标签表长度
+// 列依次为 x, y, w, h, score (float32) 与 labelId (int32)；
+// 标签表为 quint32 字节数 + UTF-8 文本，按 labelId 顺序排列。
+class DetectionResultIO {
+public:
+    enum class Format { Json, Binary };
+    // 进度回调：已完成量 / 总量（读按字节，写按框数）；返回 false 表示取消
+    using Progress = std::function<bool(qint64 done, qint64 total)>;
+
+    struct Outcome {
+        bool ok{false};
+        bool canceled{false};
+        QString error;
+        DetectionResult result;     // 仅加载时有效
+    };
+
+    static constexpr quint16 kBinaryVersion = 1;
+    static constexpr int kProgressRange = 1000;
+
+    // 先看文件头，读不到时按后缀判断
+    static Format detectFormat(const QString& path);
+    static Format formatForSuffix(const QString& path);
+
+    static Outcome readJson(const QString& path, const Progress& progress = Progress());
+    static Outcome writeJson(const DetectionResult& result, const QString& path,
+                             const Progress& progress = Progress());
+    // 映射在返回的结果及其副本全部销毁（或被修改）后才解除；无法映射时退化为整体读入
+    static Outcome mapBinary(const QString& path);
+    static Outcome writeBinary(const DetectionResult& result, const QString& path,
+                               const Progress& progress = Progress());
+
+    // 在线程池中执行，进度范围 0..kProgressRange；future.cancel() 在下一次进度回调时生效
+    static QFuture<Outcome> loadAsync(const QString& path);
+    static QFuture<Outcome> saveAsync(const DetectionResult& result, const QString& path);
+};
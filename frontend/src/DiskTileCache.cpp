@@ -0,0 +1,229 @@
+#include "DiskTileCache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// 文件头：magic, width, height, Content-Type 长度（小端 uint32），随后是 Content-Type 与编码字节
+constexpr quint32 kMagic = 0x32435457; // "WTC2"
+constexpr int kHeaderSize = 16;
+
+} // namespace
+
+DiskTileCache& DiskTileCache::instance() {
+    static DiskTileCache cache;
+    return cache;
+}
+
+DiskTileCache::DiskTileCache() {
+    m_root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/tiles");
+    QDir().mkpath(m_root);
+    // 缓存目录可能有数万个文件，首次 instance() 多在 GUI 线程，不在这里同步遍历
+    m_scan = QtConcurrent::run([this]() { scan(); });
+}
+
+DiskTileCache::~DiskTileCache() {
+    m_scan.waitForFinished();
+}
+
+QString DiskTileCache::slideIdentity(const QString& path, const QString& origin, const QString& version) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const QFileInfo info(path);
+    if (info.exists()) {
+        hash.addData(info.canonicalFilePath().toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    } else {
+        hash.addData(origin.toUtf8());
+        hash.addData(path.toUtf8());
+        hash.addData(version.toUtf8());
+    }
+    return QString::fromLatin1(hash.result().toHex().left(20));
+}
+
+QString DiskTileCache::relativePath(const QString& slide, const TileKey& key) const {
+    return QStringLiteral("%1/%2/%3_%4.tile").arg(slide).arg(key.level).arg(key.x).arg(key.y);
+}
+
+void DiskTileCache::scan() {
+    QDirIterator it(m_root, QStringList{QStringLiteral("*.tile")}, QDir::Files, QDirIterator::Subdirectories);
+    const QDir root(m_root);
+    QVector<std::pair<qint64, std::pair<QString, qint64>>> byTime;
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        byTime.push_back({fi.lastModified().toMSecsSinceEpoch(), {root.relativeFilePath(fi.filePath()), fi.size()}});
+    }
+    // 用修改时间恢复上次会话的访问顺序；都排在本次会话访问过的条目之前（访问号 <= 0）
+    std::sort(byTime.begin(), byTime.end());
+
+    QStringList victims;
+    {
+        QMutexLocker locker(&m_mutex);
+        qint64 order = -static_cast<qint64>(byTime.size());
+        for (const auto& item : std::as_const(byTime)) {
+            ++order;
+            // 遍历期间本次会话已写入的以内存索引为准
+            if (m_entries.contains(item.second.first)) continue;
+            m_entries.insert(item.second.first, Entry{item.second.second, order});
+            m_totalBytes += item.second.second;
+        }
+        m_indexed = true;
+        victims = evictLocked();
+    }
+    removeFiles(victims);
+}
+
+bool DiskTileCache::contains(const QString& slide, const TileKey& key) const {
+    if (slide.isEmpty()) return false;
+    const QString rel = relativePath(slide, key);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_entries.contains(rel)) return true;
+        if (m_indexed) return false;
+    }
+    // 索引还没建好：直接看文件，重启后的首批读取同样命中磁盘
+    return QFile::exists(m_root + QLatin1Char('/') + rel);
+}
+
+bool DiskTileCache::load(const QString& slide, const TileKey& key, TilePayload* payload) {
+    if (slide.isEmpty() || !payload) return false;
+    const QString rel = relativePath(slide, key);
+    const QString path = m_root + QLatin1Char('/') + rel;
+
+    bool ok = false;
+    qint64 fileSize = 0;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QByteArray data = file.readAll();
+        fileSize = data.size();
+        const uchar* head = reinterpret_cast<const uchar*>(data.constData());
+        if (data.size() >= kHeaderSize && qFromLittleEndian<quint32>(head) == kMagic) {
+            const qint64 typeLength = qFromLittleEndian<quint32>(head + 12);
+            if (data.size() >= kHeaderSize + typeLength) {
+                payload->width = static_cast<int>(qFromLittleEndian<quint32>(head + 4));
+                payload->height = static_cast<int>(qFromLittleEndian<quint32>(head + 8));
+                payload->contentType = data.mid(kHeaderSize, typeLength);
+                payload->bytes = data.mid(kHeaderSize + typeLength);
+                ok = !payload->bytes.isEmpty();
+            }
+        }
+        file.close();
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.find(rel);
+        if (ok) {
+            if (it != m_entries.end()) {
+                it->lastAccess = ++m_clock;
+            } else {
+                // 遍历完成前读到的文件先记入索引，遍历结果不会重复计入
+                m_entries.insert(rel, Entry{fileSize, ++m_clock});
+                m_totalBytes += fileSize;
+            }
+            return true;
+        }
+        if (it != m_entries.end()) {
+            m_totalBytes -= it->size;
+            m_entries.erase(it);
+        }
+    }
+    // 损坏或旧格式的文件
+    QFile::remove(path);
+    return false;
+}
+
+void DiskTileCache::store(const QString& slide, const TileKey& key, const TilePayload& payload) {
+    if (slide.isEmpty() || payload.bytes.isEmpty()) return;
+    const QString rel = relativePath(slide, key);
+    const QString path = m_root + QLatin1Char('/') + rel;
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QByteArray header(kHeaderSize, Qt::Uninitialized);
+    uchar* h = reinterpret_cast<uchar*>(header.data());
+    qToLittleEndian<quint32>(kMagic, h);
+    qToLittleEndian<quint32>(static_cast<quint32>(std::max(0, payload.width)), h + 4);
+    qToLittleEndian<quint32>(static_cast<quint32>(std::max(0, payload.height)), h + 8);
+    qToLittleEndian<quint32>(static_cast<quint32>(payload.contentType.size()), h + 12);
+
+    // 先写临时文件再原子替换，读方不会看到写了一半的 tile
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(header);
+    file.write(payload.contentType);
+    file.write(payload.bytes);
+    if (!file.commit()) return;
+
+    const qint64 size = kHeaderSize + payload.contentType.size() + payload.bytes.size();
+    QStringList victims;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.find(rel);
+        if (it != m_entries.end()) {
+            m_totalBytes -= it->size;
+        }
+        m_entries.insert(rel, Entry{size, ++m_clock});
+        m_totalBytes += size;
+        victims = evictLocked();
+    }
+    removeFiles(victims);
+}
+
+void DiskTileCache::setMaxBytes(qint64 bytes) {
+    QStringList victims;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxBytes = std::max<qint64>(0, bytes);
+        victims = evictLocked();
+    }
+    removeFiles(victims);
+}
+
+qint64 DiskTileCache::maxBytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_maxBytes;
+}
+
+qint64 DiskTileCache::totalBytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_totalBytes;
+}
+
+QStringList DiskTileCache::evictLocked() {
+    QStringList victims;
+    if (m_totalBytes <= m_maxBytes) return victims;
+    // 一次清到上限的 90%，避免每写一块就排序一次
+    const qint64 target = m_maxBytes - m_maxBytes / 10;
+    QVector<std::pair<qint64, QString>> order;
+    order.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        order.push_back({it->lastAccess, it.key()});
+    }
+    std::sort(order.begin(), order.end());
+    for (const auto& item : order) {
+        if (m_totalBytes <= target) break;
+        victims.push_back(m_root + QLatin1Char('/') + item.second);
+        m_totalBytes -= m_entries.take(item.second).size;
+    }
+    return victims;
+}
+
+void DiskTileCache::removeFiles(const QStringList& paths) {
+    for (const QString& path : paths) {
+        QFile::remove(path);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "TileCache.h"
+#include "TileSource.h"
+
+#include <QString>
+#include <QStringList>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+
+// 磁盘二级 tile 缓存：按 切片标识/level/x_y.tile 原样存放后端传来的编码字节（JPEG/PNG 等），
+// 读取后由调用方解码。内存中维护 文件 -> (大小, 最近访问) 索引，总量超过上限时按 LRU
+// 删除最久未用的文件；索引在线程池中建立（程序启动时即开始，见 WSIHandler 构造），
+// 建好之前的查询直接检查磁盘上的文件。线程安全。
+class DiskTileCache {
+public:
+    static DiskTileCache& instance();
+    ~DiskTileCache();
+
+    // 切片标识：规范化路径 + 文件大小 + 修改时间的哈希；
+    // 文件不在本机时用来源、路径与后端报告的版本（大小/修改时间）
+    static QString slideIdentity(const QString& path, const QString& origin, const QString& version = QString());
+
+    bool contains(const QString& slide, const TileKey& key) const;
+    bool load(const QString& slide, const TileKey& key, TilePayload* payload);
+    void store(const QString& slide, const TileKey& key, const TilePayload& payload);
+
+    void setMaxBytes(qint64 bytes);
+    qint64 maxBytes() const;
+    qint64 totalBytes() const;
+
+private:
+    DiskTileCache();
+
+    struct Entry {
+        qint64 size{0};
+        qint64 lastAccess{0};
+    };
+
+    QString relativePath(const QString& slide, const TileKey& key) const;
+    void scan();
+    // 只更新索引，返回待删除的文件；删除放在锁外进行
+    QStringList evictLocked();
+    static void removeFiles(const QStringList& paths);
+
+    QString m_root;
+    QFuture<void> m_scan;
+    bool m_indexed{false};      // 目录遍历完成；由 m_mutex 保护
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    qint64 m_totalBytes{0};
+    qint64 m_maxBytes{2ll * 1024 * 1024 * 1024};
+    qint64 m_clock{0};
+};
@@ -0,0 +1,236 @@
+#include "HeatmapEngine.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 行带大小：足够大以摊薄调度开销
+constexpr int kRowsPerBand = 32;
+
+template <typename Fn>
+void forEachRowBand(int rows, Fn fn) {
+    QVector<int> bands;
+    for (int y = 0; y < rows; y += kRowsPerBand) {
+        bands.push_back(y);
+    }
+    if (bands.size() <= 1) {
+        for (int start : std::as_const(bands)) fn(start, std::min(rows, start + kRowsPerBand));
+        return;
+    }
+    QtConcurrent::blockingMap(bands, [&fn, rows](int start) {
+        fn(start, std::min(rows, start + kRowsPerBand));
+    });
+}
+
+} // namespace
+
+void HeatmapEngine::clear() {
+    m_bounds = QRectF();
+    m_size = QSize();
+    m_density.clear();
+    m_kernel.clear();
+    m_radius = 0;
+    m_boxCount = 0;
+}
+
+void HeatmapEngine::reset(const QRectF& worldBounds, const QSize& gridSize, double sigma) {
+    clear();
+    if (worldBounds.isEmpty() || gridSize.isEmpty()) return;
+    m_bounds = worldBounds;
+    m_size = gridSize;
+    m_sigma = std::max(0.5, sigma);
+    m_density.fill(0.0f, m_size.width() * m_size.height());
+    buildKernel();
+}
+
+void HeatmapEngine::buildKernel() {
+    m_radius = std::max(1, static_cast<int>(std::ceil(3.0 * m_sigma)));
+    m_kernel.resize(2 * m_radius + 1);
+    const double denom = 2.0 * m_sigma * m_sigma;
+    double sum = 0.0;
+    for (int i = -m_radius; i <= m_radius; ++i) {
+        const double v = std::exp(-(i * i) / denom);
+        m_kernel[i + m_radius] = static_cast<float>(v);
+        sum += v;
+    }
+    for (auto& v : m_kernel) {
+        v = static_cast<float>(v / sum);
+    }
+}
+
+void HeatmapEngine::addBoxes(const DetectionResult& result, int from) {
+    if (m_density.isEmpty()) return;
+    from = std::clamp(from, 0, result.count());
+    const int added = result.count() - from;
+    if (added <= 0) return;
+
+    // 新增的少：逐框叠加核的足迹，代价 O(新增 × 核面积)；
+    // 多：撒成脉冲后整体模糊一次再叠加，代价 O(网格 × 核宽)
+    const qint64 kernelArea = static_cast<qint64>(m_kernel.size()) * m_kernel.size();
+    const qint64 gridCells = static_cast<qint64>(m_size.width()) * m_size.height();
+    if (static_cast<qint64>(added) * kernelArea < gridCells * m_kernel.size() / 4) {
+        splatKernels(result, from);
+    } else {
+        QVector<float> impulses(m_density.size(), 0.0f);
+        splatImpulses(result, from, &impulses);
+        blurInto(impulses, &m_density);
+    }
+    m_boxCount = result.count();
+}
+
+void HeatmapEngine::splatImpulses(const DetectionResult& result, int from, QVector<float>* grid) const {
+    const int w = m_size.width();
+    const int h = m_size.height();
+    const double sx = w / m_bounds.width();
+    const double sy = h / m_bounds.height();
+    float* out = grid->data();
+    const float* xs = result.xData();
+    const float* ys = result.yData();
+    const float* ws = result.widthData();
+    const float* hs = result.heightData();
+    const float* scores = result.scoreData();
+    for (int i = from; i < result.count(); ++i) {
+        const QPointF c(xs[i] + 0.5 * ws[i], ys[i] + 0.5 * hs[i]);
+        // 双线性撒点，避免中心取整带来的块状
+        const double gx = (c.x() - m_bounds.left()) * sx - 0.5;
+        const double gy = (c.y() - m_bounds.top()) * sy - 0.5;
+        const int x0 = static_cast<int>(std::floor(gx));
+        const int y0 = static_cast<int>(std::floor(gy));
+        const float fx = static_cast<float>(gx - x0);
+        const float fy = static_cast<float>(gy - y0);
+        const float weight = std::clamp(scores[i], 0.0f, 1.0f);
+        const float wts[4] = {(1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy};
+        const int px[4] = {x0, x0 + 1, x0, x0 + 1};
+        const int py[4] = {y0, y0, y0 + 1, y0 + 1};
+        for (int k = 0; k < 4; ++k) {
+            if (px[k] < 0 || py[k] < 0 || px[k] >= w || py[k] >= h) continue;
+            out[py[k] * w + px[k]] += weight * wts[k];
+        }
+    }
+}
+
+void HeatmapEngine::splatKernels(const DetectionResult& result, int from) {
+    const int w = m_size.width();
+    const int h = m_size.height();
+    const double sx = w / m_bounds.width();
+    const double sy = h / m_bounds.height();
+    const float* kernel = m_kernel.constData();
+    float* out = m_density.data();
+    const float* xs = result.xData();
+    const float* ys = result.yData();
+    const float* ws = result.widthData();
+    const float* hs = result.heightData();
+    const float* scores = result.scoreData();
+    for (int i = from; i < result.count(); ++i) {
+        const QPointF c(xs[i] + 0.5 * ws[i], ys[i] + 0.5 * hs[i]);
+        const int cx = static_cast<int>(std::floor((c.x() - m_bounds.left()) * sx));
+        const int cy = static_cast<int>(std::floor((c.y() - m_bounds.top()) * sy));
+        const float weight = std::clamp(scores[i], 0.0f, 1.0f);
+        const int xBegin = std::max(0, cx - m_radius);
+        const int xEnd = std::min(w, cx + m_radius + 1);
+        for (int y = std::max(0, cy - m_radius); y < std::min(h, cy + m_radius + 1); ++y) {
+            const float ky = weight * kernel[y - cy + m_radius];
+            float* row = out + static_cast<qint64>(y) * w;
+            const int offset = m_radius - cx;
+            for (int x = xBegin; x < xEnd; ++x) {
+                row[x] += ky * kernel[x + offset];
+            }
+        }
+    }
+}
+
+void HeatmapEngine::blurInto(const QVector<float>& impulses, QVector<float>* out) const {
+    const int w = m_size.width();
+    const int h = m_size.height();
+    const int r = m_radius;
+    const float* kernel = m_kernel.constData();
+    QVector<float> horizontal(impulses.size(), 0.0f);
+
+    // 横向：每行独立
+    const float* src = impulses.constData();
+    float* tmp = horizontal.data();
+    forEachRowBand(h, [=](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            const float* in = src + static_cast<qint64>(y) * w;
+            float* dst = tmp + static_cast<qint64>(y) * w;
+            for (int k = -r; k <= r; ++k) {
+                const float kv = kernel[k + r];
+                const int xBegin = std::max(0, -k);
+                const int xEnd = std::min(w, w - k);
+                for (int x = xBegin; x < xEnd; ++x) {
+                    dst[x] += kv * in[x + k];
+                }
+            }
+        }
+    });
+
+    // 纵向：按输出行分带，内层沿列连续，叠加到 out
+    float* dst = out->data();
+    forEachRowBand(h, [=](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            float* row = dst + static_cast<qint64>(y) * w;
+            for (int k = std::max(-r, -y); k <= std::min(r, h - 1 - y); ++k) {
+                const float kv = kernel[k + r];
+                const float* in = tmp + static_cast<qint64>(y + k) * w;
+                for (int x = 0; x < w; ++x) {
+                    row[x] += kv * in[x];
+                }
+            }
+        }
+    });
+}
+
+float HeatmapEngine::maxDensity() const {
+    float peak = 0.0f;
+    for (float v : m_density) {
+        peak = std::max(peak, v);
+    }
+    return peak;
+}
+
+const std::array<QRgb, 256>& HeatmapEngine::colorMap() {
+    static const std::array<QRgb, 256> lut = [] {
+        std::array<QRgb, 256> table{};
+        for (int i = 0; i < 256; ++i) {
+            const double t = i / 255.0;
+            // 先红后橙再黄，透明度随密度升高
+            const int red = 255;
+            const int green = static_cast<int>(std::clamp((t - 0.35) / 0.65, 0.0, 1.0) * 255.0);
+            const int blue = static_cast<int>(std::clamp((t - 0.85) / 0.15, 0.0, 1.0) * 160.0);
+            const int alpha = i == 0 ? 0 : static_cast<int>(40.0 + 200.0 * std::sqrt(t));
+            table[i] = qPremultiply(qRgba(red, green, blue, alpha));
+        }
+        return table;
+    }();
+    return lut;
+}
+
+QImage HeatmapEngine::render(float maxValue) const {
+    if (m_density.isEmpty()) return QImage();
+    QImage image(m_size, QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull()) return QImage();
+
+    const float peak = maxValue > 0.0f ? maxValue : maxDensity();
+    const float scale = peak > 0.0f ? 255.0f / peak : 0.0f;
+    const auto& lut = colorMap();
+    const float* src = m_density.constData();
+    const int w = m_size.width();
+    // 先取出像素指针，工作线程里不再调用 QImage 的非 const 接口
+    uchar* bits = image.bits();
+    const qsizetype bytesPerLine = image.bytesPerLine();
+    forEachRowBand(m_size.height(), [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            const float* in = src + static_cast<qint64>(y) * w;
+            QRgb* out = reinterpret_cast<QRgb*>(bits + bytesPerLine * y);
+            for (int x = 0; x < w; ++x) {
+                const int index = std::min(255, static_cast<int>(in[x] * scale));
+                out[x] = lut[index];
+            }
+        }
+    });
+    return image;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "DetectionResult.h"
+
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+#include <QRgb>
+
+#include <array>
+
+// 检测热力图的密度计算：把分数按框中心撒到浮点网格上，做可分离高斯模糊，
+// 再经颜色查找表映射成图像。模糊按行带分到线程池并行，内层循环是连续的 float 运算，
+// 便于编译器向量化。高斯是线性的，追加框时只需处理新增部分。
+class HeatmapEngine {
+public:
+    // worldBounds 映射到 gridSize 的网格；sigma 以网格像素计
+    void reset(const QRectF& worldBounds, const QSize& gridSize, double sigma);
+    void clear();
+    bool isEmpty() const { return m_density.isEmpty(); }
+
+    // 把第 from 个及之后的框累加进密度；from 之前的视为已处理
+    void addBoxes(const DetectionResult& result, int from = 0);
+    int boxCount() const { return m_boxCount; }
+
+    QSize gridSize() const { return m_size; }
+    QRectF worldBounds() const { return m_bounds; }
+    const QVector<float>& density() const { return m_density; }
+    float maxDensity() const;
+
+    // 按 maxValue 归一化后查表；maxValue <= 0 时使用当前最大值
+    QImage render(float maxValue = 0.0f) const;
+    // 透明 -> 红 -> 橙 -> 黄，预乘 ARGB
+    static const std::array<QRgb, 256>& colorMap();
+
+private:
+    void buildKernel();
+    void splatImpulses(const DetectionResult& result, int from, QVector<float>* grid) const;
+    void splatKernels(const DetectionResult& result, int from);
+    void blurInto(const QVector<float>& impulses, QVector<float>* out) const;
+
+    QRectF m_bounds;
+    QSize m_size;
+    double m_sigma{8.0};
+    int m_radius{0};
+    QVector<float> m_kernel;    // 2 * m_radius + 1
+    QVector<float> m_density;
+    int m_boxCount{0};
+};
@@ -0,0 +1,81 @@
+#include "HeatmapPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// 单层网格上限，更细的 level 直接跳过，放大时由已有的最细层平滑插值
+constexpr qint64 kMaxCellsPerLevel = 16ll * 1024 * 1024;
+constexpr double kSigmaCells = 2.0;
+}
+
+std::shared_ptr<const HeatmapPyramid> HeatmapPyramid::build(const DetectionResult& result, const QSize& slideSize,
+                                                            const QVector<double>& levelDownsamples) {
+    auto pyramid = std::make_shared<HeatmapPyramid>();
+    if (result.isEmpty() || slideSize.isEmpty() || levelDownsamples.isEmpty()) return pyramid;
+
+    const QRectF bounds(QPointF(0.0, 0.0), QSizeF(slideSize));
+    double sigmaWorld = 0.0;
+    for (int i = 0; i < levelDownsamples.size(); ++i) {
+        const double down = levelDownsamples[i] > 0.0 ? levelDownsamples[i] : std::pow(2.0, i);
+        const double cell = down * kCellPixels;
+        const int w = std::max(1, static_cast<int>(std::ceil(slideSize.width() / cell)));
+        const int h = std::max(1, static_cast<int>(std::ceil(slideSize.height() / cell)));
+        if (static_cast<qint64>(w) * h > kMaxCellsPerLevel) continue;
+
+        // 以第一个可用层为准确定 level0 下的高斯宽度，更粗的层保持同样的物理尺度
+        if (sigmaWorld <= 0.0) {
+            sigmaWorld = kSigmaCells * cell;
+        }
+        auto level = std::make_shared<Level>();
+        level->cellSize = cell;
+        level->engine.reset(bounds, QSize(w, h), std::max(1.0, sigmaWorld / cell));
+        level->engine.addBoxes(result);
+        level->maxValue = level->engine.maxDensity();
+        pyramid->m_levels.push_back(level);
+    }
+    return pyramid;
+}
+
+double HeatmapPyramid::cellSize(int level) const {
+    if (level < 0 || level >= m_levels.size()) return 0.0;
+    return m_levels[level]->cellSize;
+}
+
+QSize HeatmapPyramid::gridSize(int level) const {
+    if (level < 0 || level >= m_levels.size()) return QSize();
+    return m_levels[level]->engine.gridSize();
+}
+
+int HeatmapPyramid::levelForScale(double viewScale) const {
+    if (m_levels.isEmpty() || viewScale <= 0.0) return -1;
+    for (int i = 0; i < m_levels.size(); ++i) {
+        if (m_levels[i]->cellSize * viewScale >= 0.5) return i;
+    }
+    return m_levels.size() - 1;
+}
+
+QImage HeatmapPyramid::renderTile(int level, int tileX, int tileY) const {
+    if (level < 0 || level >= m_levels.size()) return QImage();
+    const Level& lv = *m_levels[level];
+    const QSize grid = lv.engine.gridSize();
+    const int x0 = tileX * kTileSize;
+    const int y0 = tileY * kTileSize;
+    const int w = std::min(kTileSize, grid.width() - x0);
+    const int h = std::min(kTileSize, grid.height() - y0);
+    if (w <= 0 || h <= 0) return QImage();
+
+    QImage tile(w, h, QImage::Format_ARGB32_Premultiplied);
+    if (tile.isNull()) return QImage();
+    const float scale = lv.maxValue > 0.0f ? 255.0f / lv.maxValue : 0.0f;
+    const auto& lut = HeatmapEngine::colorMap();
+    const float* density = lv.engine.density().constData();
+    for (int y = 0; y < h; ++y) {
+        const float* in = density + static_cast<qint64>(y0 + y) * grid.width() + x0;
+        QRgb* out = reinterpret_cast<QRgb*>(tile.scanLine(y));
+        for (int x = 0; x < w; ++x) {
+            out[x] = lut[std::min(255, static_cast<int>(in[x] * scale))];
+        }
+    }
+    return tile;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "HeatmapEngine.h"
+
+#include <QImage>
+#include <QSize>
+#include <QVector>
+
+#include <memory>
+
+// 覆盖整张切片的热力图多级密度，与切片的 level 一一对应：
+// 第 L 层每个密度像素对应该 level 的 kCellPixels 个像素，高斯宽度在 level0 坐标下各层一致。
+// 构建完成后只读，可在后台线程构建、GUI 线程按 tile 着色。
+class HeatmapPyramid {
+public:
+    static constexpr int kTileSize = 256;
+    static constexpr int kCellPixels = 16;
+
+    // 耗时，应放到后台线程调用
+    static std::shared_ptr<const HeatmapPyramid> build(const DetectionResult& result, const QSize& slideSize,
+                                                       const QVector<double>& levelDownsamples);
+
+    int levelCount() const { return m_levels.size(); }
+    // 每个密度像素覆盖的 level0 像素数
+    double cellSize(int level) const;
+    QSize gridSize(int level) const;
+    // 密度像素在屏幕上不小于 0.5px 的最细一层
+    int levelForScale(double viewScale) const;
+    QImage renderTile(int level, int tileX, int tileY) const;
+
+private:
+    struct Level {
+        double cellSize{1.0};
+        HeatmapEngine engine;
+        float maxValue{0.0f};
+    };
+    QVector<std::shared_ptr<Level>> m_levels;   // 由细到粗
+};
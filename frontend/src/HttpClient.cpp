@@ -5,29 +5,313 @@
 #include <QEventLoop>
 #include <QTimer>
 #include <QJsonDocument>
+#include <QThreadStorage>
+#include <QSemaphore>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QMetaObject>
 
-QJsonObject HttpClient::postJsonSync(const QUrl& base, const QString& path, const QJsonObject& payload, int timeoutMs){
-    QNetworkAccessManager mgr;
-    QUrl url(base);
-    url.setPath(path);
-    QNetworkRequest req(url);
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+
+namespace {
+
+QThreadStorage<QNetworkAccessManager*> g_threadManagers;
+
+std::atomic<int> g_maxInFlightPerHost{12};
+QMutex g_hostMutex;
+QHash<QString, std::shared_ptr<QSemaphore>> g_hostSlots;
+
+QString hostKey(const QUrl& url) {
+    const int defaultPort = url.scheme().compare(QLatin1String("https"), Qt::CaseInsensitive) == 0 ? 443 : 80;
+    return url.scheme() + QLatin1String("://") + url.host() + QLatin1Char(':') + QString::number(url.port(defaultPort));
+}
+
+std::shared_ptr<QSemaphore> hostSemaphore(const QUrl& url) {
+    QMutexLocker locker(&g_hostMutex);
+    auto& slot = g_hostSlots[hostKey(url)];
+    if (!slot) {
+        slot = std::make_shared<QSemaphore>(g_maxInFlightPerHost.load());
+    }
+    return slot;
+}
+
+// 占用一个 host 在途名额，析构时归还
+class HostSlotGuard {
+public:
+    HostSlotGuard(const QUrl& url, int timeoutMs) : m_sem(hostSemaphore(url)) {
+        m_acquired = m_sem->tryAcquire(1, timeoutMs);
+    }
+    ~HostSlotGuard() {
+        if (m_acquired) m_sem->release();
+    }
+    bool acquired() const { return m_acquired; }
+
+private:
+    std::shared_ptr<QSemaphore> m_sem;
+    bool m_acquired{false};
+};
+
+QByteArray runSync(const QNetworkRequest& req, const QByteArray* body, int timeoutMs, bool* ok) {
+    if (ok) *ok = false;
+
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+    HostSlotGuard slot(req.url(), timeoutMs);
+    if (!slot.acquired()) {
+        return QByteArray();
+    }
+    const int remainingMs = std::max(1, timeoutMs - static_cast<int>(waitTimer.elapsed()));
+
+    QNetworkAccessManager* mgr = HttpClient::threadManager();
     QEventLoop loop;
     QTimer timer;
     timer.setSingleShot(true);
     QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
 
-    QNetworkReply* reply = mgr.post(req, QJsonDocument(payload).toJson(QJsonDocument::Compact));
+    QNetworkReply* reply = body ? mgr->post(req, *body) : mgr->get(req);
     QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    timer.start(timeoutMs);
-    loop.exec();
+    timer.start(remainingMs);
+    if (!reply->isFinished()) {
+        loop.exec();
+    }
+
+    QByteArray out;
+    if (reply->isFinished() && reply->error() == QNetworkReply::NoError) {
+        out = reply->readAll();
+        if (ok) *ok = true;
+    } else if (!reply->isFinished()) {
+        reply->abort();
+    }
+    reply->deleteLater();
+    return out;
+}
+
+// 单网络线程：持有一个 QNetworkAccessManager，按上限分发排队的请求
+class AsyncEngine {
+public:
+    struct Job {
+        quint64 id{0};
+        QNetworkRequest request;
+        QByteArray body;
+        bool post{false};
+        int timeoutMs{15000};
+        HttpClient::Callback done;
+        HttpClient::ChunkCallback onData;
+    };
+
+    static AsyncEngine& instance() {
+        static AsyncEngine engine;
+        return engine;
+    }
+
+    quint64 submit(Job job) {
+        job.id = m_nextId.fetch_add(1);
+        const quint64 id = job.id;
+        QMetaObject::invokeMethod(m_context, [this, job = std::move(job)]() mutable {
+            m_queue.push_back(std::move(job));
+            pump();
+        }, Qt::QueuedConnection);
+        return id;
+    }
+
+    void cancel(quint64 id) {
+        if (id == 0) return;
+        QMetaObject::invokeMethod(m_context, [this, id]() {
+            auto queued = std::find_if(m_queue.begin(), m_queue.end(), [id](const Job& job) { return job.id == id; });
+            if (queued != m_queue.end()) {
+                const HttpClient::Callback done = std::move(queued->done);
+                m_queue.erase(queued);
+                if (done) done(HttpResponse());
+                return;
+            }
+            // abort 会同步触发 finished，由那里统一回调与清理
+            if (QNetworkReply* reply = m_replies.value(id)) {
+                reply->abort();
+            }
+        }, Qt::QueuedConnection);
+    }
+
+    void setMaxInFlight(int count) {
+        m_maxInFlight.store(std::max(1, count));
+        QMetaObject::invokeMethod(m_context, [this]() { pump(); }, Qt::QueuedConnection);
+    }
+
+private:
+    AsyncEngine() {
+        m_thread.setObjectName(QStringLiteral("HttpClientNetwork"));
+        m_context = new QObject();
+        m_context->moveToThread(&m_thread);
+        QObject::connect(&m_thread, &QThread::finished, m_context, &QObject::deleteLater);
+        m_thread.start();
+    }
+
+    ~AsyncEngine() {
+        m_thread.quit();
+        m_thread.wait();
+    }
+
+    // 仅在网络线程上调用
+    void pump() {
+        if (!m_manager) {
+            m_manager = new QNetworkAccessManager(m_context);
+            m_manager->setAutoDeleteReplies(false);
+        }
+        while (m_inFlight < m_maxInFlight.load() && !m_queue.empty()) {
+            Job job = std::move(m_queue.front());
+            m_queue.pop_front();
+            start(std::move(job));
+        }
+    }
+
+    void start(Job job) {
+        job.request.setTransferTimeout(job.timeoutMs);
+        QNetworkReply* reply = job.post ? m_manager->post(job.request, job.body)
+                                        : m_manager->get(job.request);
+        ++m_inFlight;
+        const quint64 id = job.id;
+        m_replies.insert(id, reply);
+        const HttpClient::ChunkCallback onData = job.onData;
+        if (onData) {
+            // 流式响应：数据到达即交给调用方，不在 body 中累积
+            QObject::connect(reply, &QNetworkReply::readyRead, m_context, [reply, onData]() {
+                if (reply->error() == QNetworkReply::NoError) {
+                    onData(reply->readAll());
+                }
+            });
+        }
+        QObject::connect(reply, &QNetworkReply::finished, m_context, [this, id, reply, onData, done = std::move(job.done)]() {
+            m_replies.remove(id);
+            HttpResponse response;
+            response.ok = reply->error() == QNetworkReply::NoError;
+            response.status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (response.ok) {
+                response.headers = reply->rawHeaderPairs();
+                if (onData) {
+                    const QByteArray rest = reply->readAll();
+                    if (!rest.isEmpty()) onData(rest);
+                } else {
+                    response.body = reply->readAll();
+                }
+            }
+            reply->deleteLater();
+            --m_inFlight;
+            if (done) done(response);
+            pump();
+        });
+    }
+
+    QThread m_thread;
+    QObject* m_context{nullptr};
+    QNetworkAccessManager* m_manager{nullptr};
+    std::deque<Job> m_queue;
+    QHash<quint64, QNetworkReply*> m_replies;
+    int m_inFlight{0};
+    std::atomic<int> m_maxInFlight{64};
+    std::atomic<quint64> m_nextId{1};
+};
+
+} // namespace
+
+QByteArray HttpResponse::header(const QByteArray& name) const {
+    for (const auto& pair : headers) {
+        if (pair.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return pair.second;
+        }
+    }
+    return QByteArray();
+}
+
+QNetworkAccessManager* HttpClient::threadManager() {
+    if (!g_threadManagers.hasLocalData()) {
+        auto* mgr = new QNetworkAccessManager();
+        mgr->setAutoDeleteReplies(false);
+        g_threadManagers.setLocalData(mgr);
+    }
+    return g_threadManagers.localData();
+}
+
+QNetworkRequest HttpClient::makeRequest(const QUrl& url) {
+    QNetworkRequest req(url);
+    req.setRawHeader("Connection", "keep-alive");
+    req.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    req.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    return req;
+}
+
+void HttpClient::setMaxInFlightPerHost(int count) {
+    // 只影响之后新建的 host 名额
+    g_maxInFlightPerHost.store(std::max(1, count));
+}
+
+int HttpClient::maxInFlightPerHost() {
+    return g_maxInFlightPerHost.load();
+}
+
+QByteArray HttpClient::getSync(const QNetworkRequest& req, int timeoutMs, bool* ok) {
+    return runSync(req, nullptr, timeoutMs, ok);
+}
+
+QByteArray HttpClient::postSync(const QNetworkRequest& req, const QByteArray& body, int timeoutMs, bool* ok) {
+    return runSync(req, &body, timeoutMs, ok);
+}
+
+QJsonObject HttpClient::postJsonSync(const QUrl& base, const QString& path, const QJsonObject& payload, int timeoutMs){
+    QUrl url(base);
+    url.setPath(path);
+    QNetworkRequest req = makeRequest(url);
+    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+
+    bool ok = false;
+    const QByteArray data = postSync(req, QJsonDocument(payload).toJson(QJsonDocument::Compact), timeoutMs, &ok);
 
     QJsonObject out;
-    if(timer.isActive() && reply->error()==QNetworkReply::NoError){
-        auto data = reply->readAll();
+    if(ok){
         auto doc = QJsonDocument::fromJson(data);
         if(doc.isObject()) out = doc.object();
     }
-    reply->deleteLater();
     return out;
 }
+
+quint64 HttpClient::getAsync(const QNetworkRequest& req, Callback done, int timeoutMs) {
+    AsyncEngine::Job job;
+    job.request = req;
+    job.timeoutMs = timeoutMs;
+    job.done = std::move(done);
+    return AsyncEngine::instance().submit(std::move(job));
+}
+
+quint64 HttpClient::postAsync(const QNetworkRequest& req, const QByteArray& body, Callback done, int timeoutMs) {
+    AsyncEngine::Job job;
+    job.request = req;
+    job.body = body;
+    job.post = true;
+    job.timeoutMs = timeoutMs;
+    job.done = std::move(done);
+    return AsyncEngine::instance().submit(std::move(job));
+}
+
+quint64 HttpClient::postStreamAsync(const QNetworkRequest& req, const QByteArray& body, ChunkCallback onData, Callback done, int timeoutMs) {
+    AsyncEngine::Job job;
+    job.request = req;
+    job.body = body;
+    job.post = true;
+    job.timeoutMs = timeoutMs;
+    job.onData = std::move(onData);
+    job.done = std::move(done);
+    return AsyncEngine::instance().submit(std::move(job));
+}
+
+void HttpClient::cancel(quint64 requestId) {
+    AsyncEngine::instance().cancel(requestId);
+}
+
+void HttpClient::setMaxAsyncInFlight(int count) {
+    AsyncEngine::instance().setMaxInFlight(count);
+}
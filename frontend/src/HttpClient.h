@@ -1,8 +1,56 @@
 #pragma once
 #include <QUrl>
 #include <QJsonObject>
+#include <QByteArray>
+#include <QNetworkRequest>
+#include <QList>
+#include <QPair>
 
+#include <functional>
+
+class QNetworkAccessManager;
+
+struct HttpResponse {
+    bool ok{false};
+    int status{0};
+    QByteArray body;
+    QList<QPair<QByteArray, QByteArray>> headers;
+
+    QByteArray header(const QByteArray& name) const;
+};
+
+// 长连接 HTTP 层：每个线程复用一个 QNetworkAccessManager（keep-alive 连接池），
+// 并按 host 限制同时在途的请求数，避免平移时瞬间压垮后端。
 class HttpClient {
 public:
     static QJsonObject postJsonSync(const QUrl& base, const QString& path, const QJsonObject& payload, int timeoutMs=15000);
+
+    static QByteArray getSync(const QNetworkRequest& req, int timeoutMs=15000, bool* ok=nullptr);
+    static QByteArray postSync(const QNetworkRequest& req, const QByteArray& body, int timeoutMs=15000, bool* ok=nullptr);
+
+    // 统一构造请求（keep-alive、HTTP/2、流水线），调用方可保存后只替换 URL 复用
+    static QNetworkRequest makeRequest(const QUrl& url = QUrl());
+
+    // 当前线程的连接管理器；线程退出时自动释放
+    static QNetworkAccessManager* threadManager();
+
+    static void setMaxInFlightPerHost(int count);
+    static int maxInFlightPerHost();
+
+    // 异步接口：所有请求由同一个网络线程发出，回调在网络线程上执行，
+    // 调用方应尽快把耗时工作（解码等）转交给线程池。
+    using Callback = std::function<void(const HttpResponse& response)>;
+    static quint64 getAsync(const QNetworkRequest& req, Callback done, int timeoutMs=15000);
+    static quint64 postAsync(const QNetworkRequest& req, const QByteArray& body, Callback done, int timeoutMs=15000);
+
+    // 流式 POST：每收到一段数据就回调 onData（网络线程），结束时回调 done（body 为空）
+    using ChunkCallback = std::function<void(const QByteArray& chunk)>;
+    static quint64 postStreamAsync(const QNetworkRequest& req, const QByteArray& body, ChunkCallback onData, Callback done, int timeoutMs=15000);
+
+    // 取消异步请求：排队中的直接移除，已发出的立即 abort；done 仍会以 ok=false 回调一次。
+    // 对已结束或未知的 id 无效果，可在任意线程调用
+    static void cancel(quint64 requestId);
+
+    // 网络线程同时在途的请求上限，超出部分在队列中等待
+    static void setMaxAsyncInFlight(int count);
 };
@@ -0,0 +1,386 @@
+#include "HttpTileSource.h"
+#include "HttpClient.h"
+
+#include <QNetworkRequest>
+#include <QUrlQuery>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVariant>
+#include <QPromise>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+struct HttpTileSource::TransferCounters {
+    struct PerFormat {
+        std::atomic<quint64> tiles{0};
+        std::atomic<quint64> bytes{0};
+        std::atomic<qint64> decodeNs{0};
+    };
+    std::array<PerFormat, 4> perFormat;
+
+    void record(TileFormat format, qint64 bytes, qint64 decodeNs) {
+        auto& c = perFormat[static_cast<int>(format)];
+        c.tiles.fetch_add(1);
+        c.bytes.fetch_add(static_cast<quint64>(std::max<qint64>(0, bytes)));
+        c.decodeNs.fetch_add(decodeNs);
+    }
+};
+
+namespace {
+
+const char* formatName(TileFormat format) {
+    switch (format) {
+    case TileFormat::Jpeg: return "jpeg";
+    case TileFormat::WebP: return "webp";
+    case TileFormat::Raw:  return "raw";
+    case TileFormat::Png:  break;
+    }
+    return "png";
+}
+
+// 按 Content-Type 解码；raw 为紧密排列的 RGB888，宽高由调用方给出
+QImage decodeTileBytes(const QByteArray& bytes, const QByteArray& contentType, int w, int h,
+                       TileFormat* formatOut) {
+    const QByteArray type = contentType.toLower();
+    if (type.startsWith("application/x-raw-rgb")) {
+        *formatOut = TileFormat::Raw;
+        const qint64 rowBytes = static_cast<qint64>(w) * 3;
+        if (w <= 0 || h <= 0 || bytes.size() < rowBytes * h) return QImage();
+        QImage out(w, h, QImage::Format_RGB888);
+        if (out.isNull()) return QImage();
+        for (int y = 0; y < h; ++y) {
+            std::memcpy(out.scanLine(y), bytes.constData() + rowBytes * y, static_cast<size_t>(rowBytes));
+        }
+        return out;
+    }
+
+    const char* qtFormat = "PNG";
+    *formatOut = TileFormat::Png;
+    if (type.startsWith("image/jpeg")) {
+        qtFormat = "JPG";
+        *formatOut = TileFormat::Jpeg;
+    } else if (type.startsWith("image/webp")) {
+        // 需要 Qt Image Formats 模块提供的 webp 插件
+        qtFormat = "WEBP";
+        *formatOut = TileFormat::WebP;
+    }
+    QImage out;
+    if (!out.loadFromData(bytes, qtFormat)) {
+        out.loadFromData(bytes);
+    }
+    return out;
+}
+
+QImage decodeTilePayload(const HttpResponse& response, TileFormat* formatOut) {
+    return decodeTileBytes(response.body, response.header("Content-Type"),
+                           response.header("X-Tile-Width").toInt(),
+                           response.header("X-Tile-Height").toInt(), formatOut);
+}
+
+// /regions 帧头：index, width, height, length（小端 uint32）
+constexpr int kBatchFrameHeader = 16;
+
+} // namespace
+
+HttpTileSource::HttpTileSource(const QUrl& backendBase)
+    : m_base(backendBase),
+      m_requestTemplate(HttpClient::makeRequest()),
+      m_counters(std::make_shared<TransferCounters>()) {}
+
+HttpTileSource::~HttpTileSource() = default;
+
+bool HttpTileSource::open(const QString& path, SlideInfo* info){
+    QUrl url(m_base);
+    url.setPath("/open_wsi");
+    QUrlQuery q; q.addQueryItem("path", path); url.setQuery(q);
+
+    QNetworkRequest req = m_requestTemplate;
+    req.setUrl(url);
+    bool sent = false;
+    const auto data = HttpClient::postSync(req, QByteArray(), 15000, &sent);
+    if(!sent){
+        return false;
+    }
+
+    const auto doc = QJsonDocument::fromJson(data);
+    if(!doc.isObject()) return false;
+    const auto obj = doc.object();
+
+    *info = SlideInfo();
+    info->slideId = obj.value("id").toInt(-1);
+    info->levelCount = obj.value("level_count").toInt(0);
+
+    const auto dimsObj = obj.value("level_dimensions");
+    if (dimsObj.isArray()) {
+        const auto dims = dimsObj.toArray();
+        for (const auto& it : dims) {
+            if (it.isObject()) {
+                const auto o = it.toObject();
+                info->levelDims.push_back(QSize(o.value("w").toInt(), o.value("h").toInt()));
+            } else if (it.isArray()) {
+                const auto pair = it.toArray();
+                if (pair.size() == 2) {
+                    info->levelDims.push_back(QSize(pair.at(0).toInt(), pair.at(1).toInt()));
+                }
+            }
+        }
+    }
+    // 旧后端不返回这两项，此时标识只含路径
+    if (obj.contains("file_size") || obj.contains("file_mtime")) {
+        info->version = obj.value("file_size").toVariant().toString() + QLatin1Char('/')
+                      + obj.value("file_mtime").toVariant().toString();
+    }
+    const auto downsamples = obj.value("level_downsamples").toArray();
+    for (const auto& it : downsamples) {
+        info->downsamples.push_back(it.toDouble(1.0));
+    }
+    if (info->downsamples.isEmpty() && !info->levelDims.isEmpty()) {
+        info->downsamples.reserve(info->levelDims.size());
+        for (int i = 0; i < info->levelDims.size(); ++i) {
+            info->downsamples.push_back(i == 0 ? 1.0 : std::pow(2.0, i));
+        }
+    }
+
+    if (info->levelCount == 0) {
+        info->levelCount = std::min(info->levelDims.size(), info->downsamples.size());
+    } else {
+        info->levelCount = std::min<int>(info->levelCount, std::min(info->levelDims.size(), info->downsamples.size()));
+    }
+
+    const bool ok = (info->slideId > 0) && (info->levelCount > 0) && !info->levelDims.isEmpty() && !info->downsamples.isEmpty();
+    if (!ok) {
+        *info = SlideInfo();
+    }
+    m_slideId = ok ? info->slideId : -1;
+    return ok;
+}
+
+void HttpTileSource::close() {
+    m_slideId = -1;
+}
+
+QUrl HttpTileSource::regionUrl(const RegionRequest& r, TileUsage usage) const {
+    const TileFormat format = tileFormat(usage);
+    const int quality = usage == TileUsage::Navigation ? m_navigationQuality : m_analysisQuality;
+
+    QUrl url(m_base);
+    url.setPath("/region");
+    QUrlQuery q;
+    q.addQueryItem("id", QString::number(m_slideId));
+    q.addQueryItem("level", QString::number(r.level));
+    q.addQueryItem("x", QString::number(r.x));
+    q.addQueryItem("y", QString::number(r.y));
+    q.addQueryItem("w", QString::number(r.w));
+    q.addQueryItem("h", QString::number(r.h));
+    q.addQueryItem("format", QLatin1String(formatName(format)));
+    if (format == TileFormat::Jpeg || format == TileFormat::WebP) {
+        q.addQueryItem("quality", QString::number(quality));
+    }
+    url.setQuery(q);
+    return url;
+}
+
+QFuture<QImage> HttpTileSource::readRegionAsync(const RegionRequest& region, TileUsage usage,
+                                                const CancelToken& cancel) {
+    auto promise = std::make_shared<QPromise<QImage>>();
+    QFuture<QImage> future = promise->future();
+    promise->start();
+    if (cancel.isCanceled()) {
+        promise->addResult(QImage());
+        promise->finish();
+        return future;
+    }
+
+    QNetworkRequest req = m_requestTemplate;
+    req.setUrl(regionUrl(region, usage));
+    // 先登记再发出：请求号在发出后才可知，取消发生在两者之间时由下面的补查处理
+    auto requestId = std::make_shared<std::atomic<quint64>>(0);
+    const int registration = cancel.onCancel([requestId]() {
+        if (const quint64 id = requestId->load()) HttpClient::cancel(id);
+    });
+    requestId->store(HttpClient::getAsync(req, [promise, cancel, registration, counters = m_counters](const HttpResponse& response) {
+        cancel.removeCallback(registration);
+        if (!response.ok || promise->isCanceled() || cancel.isCanceled()) {
+            promise->addResult(QImage());
+            promise->finish();
+            return;
+        }
+        // 网络线程只负责收发，解码放到线程池
+        QThreadPool::globalInstance()->start([promise, counters, response]() {
+            QImage out;
+            if (!promise->isCanceled()) {
+                QElapsedTimer timer;
+                timer.start();
+                TileFormat format = TileFormat::Png;
+                out = decodeTilePayload(response, &format);
+                if (!out.isNull()) {
+                    counters->record(format, response.body.size(), timer.nsecsElapsed());
+                }
+            }
+            promise->addResult(out);
+            promise->finish();
+        });
+    }));
+    if (cancel.isCanceled()) {
+        HttpClient::cancel(requestId->load());
+    }
+    return future;
+}
+
+QImage HttpTileSource::decodePayload(const TilePayload& payload) {
+    TileFormat format = TileFormat::Png;
+    return decodeTileBytes(payload.bytes, payload.contentType, payload.width, payload.height, &format);
+}
+
+QVector<QFuture<QImage>> HttpTileSource::readRegionsAsync(const QVector<RegionRequest>& regions, TileUsage usage,
+                                                          const CancelToken& cancel) {
+    return readRegionsAsync(regions, usage, cancel, PayloadSink());
+}
+
+QVector<QFuture<QImage>> HttpTileSource::readRegionsAsync(const QVector<RegionRequest>& regions, TileUsage usage,
+                                                          const CancelToken& cancel, const PayloadSink& sink) {
+    struct BatchState {
+        QVector<std::shared_ptr<QPromise<QImage>>> promises;
+        QVector<bool> dispatched;
+        QByteArray buffer;
+        QByteArray contentType;
+    };
+
+    QVector<QFuture<QImage>> futures;
+    if (regions.isEmpty()) return futures;
+    futures.reserve(regions.size());
+
+    auto state = std::make_shared<BatchState>();
+    state->promises.reserve(regions.size());
+    state->dispatched.fill(false, regions.size());
+
+    const TileFormat format = tileFormat(usage);
+    const int quality = usage == TileUsage::Navigation ? m_navigationQuality : m_analysisQuality;
+    state->contentType = format == TileFormat::Raw ? QByteArray("application/x-raw-rgb")
+                                                   : QByteArray("image/") + formatName(format);
+
+    QJsonArray list;
+    for (const auto& r : regions) {
+        auto promise = std::make_shared<QPromise<QImage>>();
+        promise->start();
+        futures.push_back(promise->future());
+        state->promises.push_back(promise);
+        list.append(QJsonObject{{"level", r.level}, {"x", r.x}, {"y", r.y}, {"w", r.w}, {"h", r.h}});
+    }
+    QJsonObject payload{{"id", m_slideId}, {"format", QLatin1String(formatName(format))},
+                        {"quality", quality}, {"regions", list}};
+
+    QUrl url(m_base);
+    url.setPath("/regions");
+    QNetworkRequest req = m_requestTemplate;
+    req.setUrl(url);
+    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+
+    // 以下回调都在网络线程上执行；每个完整帧立即转交线程池解码
+    auto onData = [state, cancel, sink, counters = m_counters](const QByteArray& chunk) {
+        state->buffer.append(chunk);
+        qsizetype offset = 0;
+        while (state->buffer.size() - offset >= kBatchFrameHeader) {
+            const uchar* head = reinterpret_cast<const uchar*>(state->buffer.constData() + offset);
+            const quint32 index = qFromLittleEndian<quint32>(head);
+            const quint32 w = qFromLittleEndian<quint32>(head + 4);
+            const quint32 h = qFromLittleEndian<quint32>(head + 8);
+            const quint32 length = qFromLittleEndian<quint32>(head + 12);
+            if (state->buffer.size() - offset - kBatchFrameHeader < static_cast<qsizetype>(length)) break;
+
+            const QByteArray frame = state->buffer.mid(offset + kBatchFrameHeader, length);
+            offset += kBatchFrameHeader + length;
+            if (index >= static_cast<quint32>(state->promises.size()) || state->dispatched[index]) continue;
+            state->dispatched[index] = true;
+
+            auto promise = state->promises[index];
+            QThreadPool::globalInstance()->start([promise, cancel, counters, sink, index, frame, w, h,
+                                                  contentType = state->contentType]() {
+                QImage out;
+                if (!frame.isEmpty() && !promise->isCanceled() && !cancel.isCanceled()) {
+                    QElapsedTimer timer;
+                    timer.start();
+                    TileFormat decoded = TileFormat::Png;
+                    out = decodeTileBytes(frame, contentType, static_cast<int>(w), static_cast<int>(h), &decoded);
+                    if (!out.isNull()) {
+                        counters->record(decoded, frame.size(), timer.nsecsElapsed());
+                    }
+                }
+                promise->addResult(out);
+                promise->finish();
+                // 先交付图像，再把原始字节交给调用方（如落盘）
+                if (sink && !out.isNull()) {
+                    sink(static_cast<int>(index), TilePayload{frame, contentType, static_cast<int>(w), static_cast<int>(h)});
+                }
+            });
+        }
+        state->buffer.remove(0, offset);
+    };
+    auto requestId = std::make_shared<std::atomic<quint64>>(0);
+    const int registration = cancel.onCancel([requestId]() {
+        if (const quint64 id = requestId->load()) HttpClient::cancel(id);
+    });
+    auto onDone = [state, cancel, registration](const HttpResponse&) {
+        cancel.removeCallback(registration);
+        for (int i = 0; i < state->promises.size(); ++i) {
+            if (state->dispatched[i]) continue;
+            state->dispatched[i] = true;
+            state->promises[i]->addResult(QImage());
+            state->promises[i]->finish();
+        }
+    };
+    if (cancel.isCanceled()) {
+        cancel.removeCallback(registration);
+        for (const auto& promise : std::as_const(state->promises)) {
+            promise->addResult(QImage());
+            promise->finish();
+        }
+        return futures;
+    }
+    requestId->store(HttpClient::postStreamAsync(req, QJsonDocument(payload).toJson(QJsonDocument::Compact), onData, onDone));
+    if (cancel.isCanceled()) {
+        HttpClient::cancel(requestId->load());
+    }
+    return futures;
+}
+
+void HttpTileSource::setTileFormat(TileUsage usage, TileFormat format, int quality) {
+    quality = std::clamp(quality, 1, 100);
+    if (usage == TileUsage::Navigation) {
+        m_navigationFormat = format;
+        m_navigationQuality = quality;
+    } else {
+        m_analysisFormat = format;
+        m_analysisQuality = quality;
+    }
+}
+
+TileFormat HttpTileSource::tileFormat(TileUsage usage) const {
+    return usage == TileUsage::Navigation ? m_navigationFormat : m_analysisFormat;
+}
+
+TransferStats HttpTileSource::transferStats(TileFormat format) const {
+    const auto& c = m_counters->perFormat[static_cast<int>(format)];
+    TransferStats stats;
+    stats.tiles = c.tiles.load();
+    stats.bytes = c.bytes.load();
+    stats.decodeMs = static_cast<double>(c.decodeNs.load()) / 1.0e6;
+    return stats;
+}
+
+void HttpTileSource::resetTransferStats() {
+    for (auto& c : m_counters->perFormat) {
+        c.tiles.store(0);
+        c.bytes.store(0);
+        c.decodeNs.store(0);
+    }
+}
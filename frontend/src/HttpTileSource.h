@@ -0,0 +1,51 @@
+#pragma once
+#include "TileSource.h"
+
+#include <QUrl>
+#include <QNetworkRequest>
+
+#include <memory>
+
+// 通过 Python 后端（/open_wsi、/region、/regions）读取像素
+class HttpTileSource : public TileSource {
+public:
+    explicit HttpTileSource(const QUrl& backendBase);
+    ~HttpTileSource() override;
+
+    bool open(const QString& path, SlideInfo* info) override;
+    void close() override;
+    // 取消时 abort 对应的网络请求，未完成的 future 以空 QImage 结束
+    QFuture<QImage> readRegionAsync(const RegionRequest& region, TileUsage usage,
+                                    const CancelToken& cancel = CancelToken()) override;
+    // 一次 /regions 请求取多个区域，随帧到达逐个完成
+    QVector<QFuture<QImage>> readRegionsAsync(const QVector<RegionRequest>& regions, TileUsage usage,
+                                              const CancelToken& cancel = CancelToken()) override;
+    // 同上；每个解码成功的区域在其 future 完成后于解码线程上回调 sink（index 对应 regions 下标）
+    using PayloadSink = std::function<void(int index, const TilePayload& payload)>;
+    QVector<QFuture<QImage>> readRegionsAsync(const QVector<RegionRequest>& regions, TileUsage usage,
+                                              const CancelToken& cancel, const PayloadSink& sink);
+    // 按 Content-Type 解码，失败时返回空图
+    static QImage decodePayload(const TilePayload& payload);
+    bool isRemote() const override { return true; }
+    QUrl backendBase() const { return m_base; }
+
+    // quality 仅对 JPEG/WebP 有效（1-100）
+    void setTileFormat(TileUsage usage, TileFormat format, int quality = 85);
+    TileFormat tileFormat(TileUsage usage) const;
+    TransferStats transferStats(TileFormat format) const;
+    void resetTransferStats();
+
+private:
+    QUrl regionUrl(const RegionRequest& r, TileUsage usage) const;
+
+    QUrl m_base;
+    QNetworkRequest m_requestTemplate;
+    int m_slideId{-1};
+
+    TileFormat m_navigationFormat{TileFormat::Jpeg};
+    int m_navigationQuality{85};
+    TileFormat m_analysisFormat{TileFormat::Png};
+    int m_analysisQuality{95};
+    struct TransferCounters;
+    std::shared_ptr<TransferCounters> m_counters;
+};
@@ -4,11 +4,170 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QStringList>
+#include <QtEndian>
+#include <QNetworkRequest>
+#include <QPromise>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
 
-QVector<DetBox> InferenceClient::analyzeViewport(const QImage& img, const ViewportMeta& meta){
-    QVector<DetBox> boxes;
-    if(img.isNull()) return boxes;
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+// 与后端 _INFER_REQ / _INFER_RESP / _INFER_BOX 对应，均为小端
+constexpr char kRequestMagic[4] = {'W', 'I', 'Q', '1'};
+constexpr char kResponseMagic[4] = {'W', 'I', 'A', '1'};
+constexpr int kRequestHeaderSize = 40;
+constexpr int kResponseHeaderSize = 20;
+constexpr int kBoxRecordSize = 40;
+
+enum PixelFormat : quint8 { PixelRgb = 0, PixelBgr = 1, PixelJpeg = 2, PixelPng = 3 };
+
+// 后端不认识本地打开的切片时，只会返回 level 坐标（已加上 origin），这里补乘 downsample
+double boxScale(const ViewportMeta& meta) {
+    return (meta.slideId > 0 || meta.downsample <= 0.0) ? 1.0 : meta.downsample;
+}
+
+} // namespace
+
+InferenceClient::InferenceClient(const QUrl& base, QObject* parent)
+    : QObject(parent), m_base(base) {}
+
+InferenceClient::~InferenceClient() {
+    cancelAll();
+}
+
+void InferenceClient::setTransport(InferenceTransport transport, int jpegQuality) {
+    m_transport = transport;
+    m_jpegQuality = std::clamp(jpegQuality, 1, 100);
+}
+
+void InferenceClient::setMaxConcurrent(int count) {
+    m_maxConcurrent = std::max(1, count);
+    pump();
+}
+
+quint64 InferenceClient::submit(const QImage& img, const ViewportMeta& meta) {
+    if (img.isNull()) return 0;
+    const quint64 id = m_nextId++;
+    m_queue.push_back(Pending{id, img, meta});
+    pump();
+    return id;
+}
+
+void InferenceClient::cancel(quint64 id) {
+    auto queued = std::find_if(m_queue.begin(), m_queue.end(), [id](const Pending& p) { return p.id == id; });
+    if (queued != m_queue.end()) {
+        m_queue.erase(queued);
+        return;
+    }
+    auto it = m_active.find(id);
+    if (it == m_active.end()) return;
+    // 编码阶段尚无 httpId，后续续体发现请求已不在 m_active 中会自行放弃
+    HttpClient::cancel(it->httpId);
+    m_active.erase(it);
+    pump();
+}
+
+void InferenceClient::cancelAll() {
+    m_queue.clear();
+    for (const Active& a : std::as_const(m_active)) {
+        HttpClient::cancel(a.httpId);
+    }
+    m_active.clear();
+}
+
+void InferenceClient::pump() {
+    while (m_active.size() < m_maxConcurrent && !m_queue.empty()) {
+        Pending next = std::move(m_queue.front());
+        m_queue.pop_front();
+        Active& a = m_active[next.id];
+        a.image = std::move(next.image);
+        a.meta = next.meta;
+        send(next.id);
+    }
+}
+
+void InferenceClient::send(quint64 id) {
+    auto it = m_active.find(id);
+    if (it == m_active.end()) return;
+    const InferenceTransport transport = (m_binaryUnsupported || it->fellBack) ? InferenceTransport::Json : m_transport;
+    it->transport = transport;
+    it->httpId = 0;
+
+    const QImage image = it->image;
+    const ViewportMeta meta = it->meta;
+    const int quality = m_jpegQuality;
+    QtConcurrent::run([image, meta, transport, quality]() {
+        return transport == InferenceTransport::Json ? encodeJsonRequest(image, meta)
+                                                     : encodeBinaryRequest(image, meta, transport, quality);
+    }).then(this, [this, id, meta, transport](const QByteArray& body) {
+        auto active = m_active.find(id);
+        if (active == m_active.end()) return;
+
+        const bool json = transport == InferenceTransport::Json;
+        QUrl url(m_base);
+        url.setPath(json ? QStringLiteral("/analyze_viewport") : QStringLiteral("/analyze_viewport_bin"));
+        QNetworkRequest req = HttpClient::makeRequest(url);
+        req.setHeader(QNetworkRequest::ContentTypeHeader,
+                      json ? QByteArray("application/json") : QByteArray("application/octet-stream"));
 
+        // 回调在网络线程上，经 promise 交给线程池解析，再回到本对象线程；对象销毁后续体自动取消
+        auto promise = std::make_shared<QPromise<HttpResponse>>();
+        promise->start();
+        promise->future()
+            .then(QThreadPool::globalInstance(), [meta, json](const HttpResponse& response) {
+                Reply reply;
+                reply.status = response.status;
+                if (response.status == 404) {
+                    const QJsonDocument doc = QJsonDocument::fromJson(response.body);
+                    reply.routeMissing = doc.isObject()
+                                         && doc.object().value(QStringLiteral("detail")).toString() == QLatin1String("Not Found");
+                }
+                if (response.ok) {
+                    reply.boxes = json ? parseJsonResponse(response.body, meta, &reply.ok)
+                                       : parseBinaryResponse(response.body, meta, &reply.ok);
+                }
+                return reply;
+            })
+            .then(this, [this, id](const Reply& reply) { complete(id, reply); });
+        active->httpId = HttpClient::postAsync(req, body, [promise](const HttpResponse& response) {
+            promise->addResult(response);
+            promise->finish();
+        });
+    });
+}
+
+void InferenceClient::complete(quint64 id, const Reply& reply) {
+    auto it = m_active.find(id);
+    if (it == m_active.end()) return;   // 已取消
+
+    // 二进制接口不存在（路由 404）时改用 JSON 重发一次；JSON 成功则认为后端较旧，之后不再尝试二进制。
+    // slide 未打开等业务错误不重发，换格式也不会成功
+    if (!reply.ok && reply.routeMissing && it->transport != InferenceTransport::Json) {
+        it->fellBack = true;
+        send(id);
+        return;
+    }
+    if (reply.ok && it->fellBack) {
+        m_binaryUnsupported = true;
+    }
+
+    const ViewportMeta meta = it->meta;
+    m_active.erase(it);
+    pump();
+    if (reply.ok) {
+        emit finished(id, meta, reply.boxes);
+    } else {
+        emit failed(id, meta, reply.status > 0 ? QStringLiteral("后端返回 HTTP %1").arg(reply.status)
+                                               : QStringLiteral("识别请求失败或超时"));
+    }
+}
+
+QByteArray InferenceClient::encodeJsonRequest(const QImage& img, const ViewportMeta& meta) {
     QByteArray bytes;
     QBuffer buf(&bytes);
     buf.open(QIODevice::WriteOnly);
@@ -23,16 +182,97 @@ QVector<DetBox> InferenceClient::analyzeViewport(const QImage& img, const Viewpo
     payload["level"] = meta.level;
     payload["origin_x"] = meta.originX;
     payload["origin_y"] = meta.originY;
+    return QJsonDocument(payload).toJson(QJsonDocument::Compact);
+}
 
-    QJsonObject resp = HttpClient::postJsonSync(m_base, "/analyze_viewport", payload);
+QVector<DetBox> InferenceClient::parseJsonResponse(const QByteArray& data, const ViewportMeta& meta, bool* ok) {
+    QVector<DetBox> boxes;
+    const QJsonDocument doc = QJsonDocument::fromJson(data);
+    const QJsonObject resp = doc.object();
+    if (ok) *ok = doc.isObject() && resp.contains("boxes");
+    const double scale = boxScale(meta);
     auto arr = resp["boxes"].toArray();
+    boxes.reserve(arr.size());
     for(const auto& it : arr){
         auto o = it.toObject();
         DetBox b;
-        b.rect = QRectF(o["x"].toDouble(), o["y"].toDouble(), o["w"].toDouble(), o["h"].toDouble());
+        b.rect = QRectF(o["x"].toDouble() * scale, o["y"].toDouble() * scale,
+                        o["w"].toDouble() * scale, o["h"].toDouble() * scale);
         b.label = o["label"].toString();
         b.score = o["score"].toDouble();
         boxes.push_back(b);
     }
     return boxes;
 }
+
+QByteArray InferenceClient::encodeBinaryRequest(const QImage& img, const ViewportMeta& meta,
+                                                InferenceTransport transport, int jpegQuality) {
+    QByteArray body(kRequestHeaderSize, Qt::Uninitialized);
+    quint8 format = PixelBgr;
+    if (transport == InferenceTransport::BinaryJpeg) {
+        format = PixelJpeg;
+        QBuffer buf(&body);
+        buf.open(QIODevice::WriteOnly | QIODevice::Append);
+        img.save(&buf, "JPEG", jpegQuality);
+    } else {
+        // 后端按 BGR 送入 OpenCV，这里直接给 BGR，省一次通道翻转
+        const QImage bgr = img.convertToFormat(QImage::Format_BGR888);
+        const qsizetype rowBytes = qsizetype(bgr.width()) * 3;
+        body.resize(kRequestHeaderSize + rowBytes * bgr.height());
+        char* dst = body.data() + kRequestHeaderSize;
+        for (int y = 0; y < bgr.height(); ++y) {
+            std::memcpy(dst + rowBytes * y, bgr.constScanLine(y), size_t(rowBytes));
+        }
+    }
+
+    char* head = body.data();
+    std::memcpy(head, kRequestMagic, 4);
+    head[4] = static_cast<char>(format);
+    head[5] = head[6] = head[7] = 0;
+    qToLittleEndian<quint32>(quint32(img.width()), head + 8);
+    qToLittleEndian<quint32>(quint32(img.height()), head + 12);
+    qToLittleEndian<qint32>(meta.slideId > 0 ? meta.slideId : 0, head + 16);
+    qToLittleEndian<qint32>(meta.level, head + 20);
+    qToLittleEndian<double>(meta.originX, head + 24);
+    qToLittleEndian<double>(meta.originY, head + 32);
+    return body;
+}
+
+QVector<DetBox> InferenceClient::parseBinaryResponse(const QByteArray& data, const ViewportMeta& meta, bool* ok) {
+    if (ok) *ok = false;
+    QVector<DetBox> boxes;
+    if (data.size() < kResponseHeaderSize || std::memcmp(data.constData(), kResponseMagic, 4) != 0) {
+        return boxes;
+    }
+    const char* p = data.constData();
+    const char* end = p + data.size();
+    const quint32 count = qFromLittleEndian<quint32>(p + 12);
+    const quint32 labelCount = qFromLittleEndian<quint32>(p + 16);
+    p += kResponseHeaderSize;
+
+    QStringList labels;
+    for (quint32 i = 0; i < labelCount; ++i) {
+        if (end - p < 2) return {};
+        const int len = qFromLittleEndian<quint16>(p);
+        p += 2;
+        if (end - p < len) return {};
+        labels << QString::fromUtf8(p, len);
+        p += len;
+    }
+    if (quint64(end - p) != quint64(count) * kBoxRecordSize) {
+        return boxes;
+    }
+
+    const double scale = boxScale(meta);
+    boxes.reserve(int(count));
+    for (quint32 i = 0; i < count; ++i, p += kBoxRecordSize) {
+        DetBox b;
+        b.rect = QRectF(qFromLittleEndian<double>(p) * scale, qFromLittleEndian<double>(p + 8) * scale,
+                        qFromLittleEndian<double>(p + 16) * scale, qFromLittleEndian<double>(p + 24) * scale);
+        b.score = qFromLittleEndian<float>(p + 32);
+        b.label = labels.value(int(qFromLittleEndian<quint32>(p + 36)));
+        boxes.push_back(b);
+    }
+    if (ok) *ok = true;
+    return boxes;
+}
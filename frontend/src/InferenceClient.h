@@ -1,21 +1,89 @@
 #pragma once
+#include <QObject>
 #include <QUrl>
 #include <QImage>
 #include <QVector>
+#include <QHash>
+#include <QString>
 #include "DetectionResult.h"
 
+#include <deque>
+
 struct ViewportMeta {
     int slideId{-1};
     int level{0};
     double originX{0.0};
     double originY{0.0};
+    double downsample{1.0};   // level -> level0；slideId 无效（本地切片）时由前端换算
 };
 
-class InferenceClient {
+// 识别请求的传输方式：Json 为 base64 PNG（兼容旧后端）；
+// 二进制接口 /analyze_viewport_bin 直接传像素（BinaryRaw 无损免编码，BinaryJpeg 适合远程后端）
+enum class InferenceTransport { Json = 0, BinaryRaw, BinaryJpeg };
+
+// 异步识别客户端：请求先排队，同时处理的数量受 maxConcurrent 限制。
+// 每个请求依次经过 编码（线程池）-> 发送（网络线程）-> 解析（线程池），
+// 结果以信号回到本对象所在线程（GUI），信号带上请求时的 ViewportMeta。
+class InferenceClient : public QObject {
+    Q_OBJECT
 public:
-    explicit InferenceClient(const QUrl& base): m_base(base) {}
-    QVector<DetBox> analyzeViewport(const QImage& img, const ViewportMeta& meta = {});
+    explicit InferenceClient(const QUrl& base, QObject* parent = nullptr);
+    ~InferenceClient() override;
+
+    // 入队并立即返回请求号（从 1 开始）；图像为空时返回 0
+    quint64 submit(const QImage& img, const ViewportMeta& meta = {});
+    // 排队中的直接移除，处理中的中断网络请求；被取消的请求不再发出任何信号
+    void cancel(quint64 id);
+    void cancelAll();
+
+    void setMaxConcurrent(int count);
+    int maxConcurrent() const { return m_maxConcurrent; }
+    int pendingCount() const { return static_cast<int>(m_queue.size()) + m_active.size(); }
+
+    void setTransport(InferenceTransport transport, int jpegQuality = 90);
+    InferenceTransport transport() const { return m_transport; }
+
+    // 两种协议的编解码，纯函数，可在任意线程调用；解析失败时 ok 为 false
+    static QByteArray encodeJsonRequest(const QImage& img, const ViewportMeta& meta);
+    static QVector<DetBox> parseJsonResponse(const QByteArray& data, const ViewportMeta& meta, bool* ok);
+    static QByteArray encodeBinaryRequest(const QImage& img, const ViewportMeta& meta,
+                                          InferenceTransport transport, int jpegQuality);
+    static QVector<DetBox> parseBinaryResponse(const QByteArray& data, const ViewportMeta& meta, bool* ok);
+
+signals:
+    void finished(quint64 id, const ViewportMeta& meta, const QVector<DetBox>& boxes);
+    void failed(quint64 id, const ViewportMeta& meta, const QString& message);
 
 private:
+    struct Pending {
+        quint64 id{0};
+        QImage image;
+        ViewportMeta meta;
+    };
+    struct Active {
+        QImage image;           // 保留到结束，二进制接口不可用时改走 JSON 重发
+        ViewportMeta meta;
+        quint64 httpId{0};
+        InferenceTransport transport{InferenceTransport::Json};
+        bool fellBack{false};   // 二进制接口 404 后改走 JSON
+    };
+    struct Reply {
+        bool ok{false};
+        int status{0};
+        bool routeMissing{false};   // 404 来自未知路由（FastAPI 默认 {"detail":"Not Found"}），而非业务错误
+        QVector<DetBox> boxes;
+    };
+
+    void pump();
+    void send(quint64 id);
+    void complete(quint64 id, const Reply& reply);
+
     QUrl m_base;
+    InferenceTransport m_transport{InferenceTransport::BinaryRaw};
+    int m_jpegQuality{90};
+    bool m_binaryUnsupported{false};
+    int m_maxConcurrent{4};
+    quint64 m_nextId{1};
+    std::deque<Pending> m_queue;
+    QHash<quint64, Active> m_active;
 };
@@ -8,17 +8,21 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
 #include <QDir>
 #include <QCoreApplication>
 #include <QStringList>
 #include <QUrl>
 #include <QMenuBar>
 #include <QAction>
+#include <QInputDialog>
 #include <QRect>
 #include <QPainter>
 #include <QPixmap>
-#include <QRadialGradient>
 #include <QDockWidget>
+#include <QProgressBar>
+#include <QtConcurrent/QtConcurrentRun>
 #include <cmath>
 #include <algorithm>
 
@@ -27,6 +31,8 @@
 #include "InferenceClient.h"
 #include "DetectionResult.h"
 #include "MiniMapWidget.h"
+#include "SlideInferenceJob.h"
+#include "DetectionMerger.h"
 
 // 从 config/settings.json 读取后端 URL（找不到则用默认）
 static QUrl loadBackendUrl() {
@@ -51,6 +57,61 @@ static QUrl loadBackendUrl() {
     return def;
 }
 
+// 侧栏热力图：按 bounds 外扩一圈边距，宽固定、高按比例
+static void configureHeatmap(HeatmapEngine* engine, QRectF bounds) {
+    if (bounds.width() <= 0.0 || bounds.height() <= 0.0) {
+        bounds = QRectF(0.0, 0.0, 512.0, 512.0);
+    }
+
+    const double marginX = std::max(bounds.width() * 0.1, 50.0);
+    const double marginY = std::max(bounds.height() * 0.1, 50.0);
+    bounds.adjust(-marginX, -marginY, marginX, marginY);
+    if (bounds.width() <= 0.0) bounds.setWidth(1.0);
+    if (bounds.height() <= 0.0) bounds.setHeight(1.0);
+
+    constexpr int kTargetWidth = 420;
+    int heatHeight = static_cast<int>(std::round(bounds.height() / bounds.width() * kTargetWidth));
+    if (heatHeight <= 0) {
+        heatHeight = kTargetWidth;
+    }
+    heatHeight = std::clamp(heatHeight, 160, 720);
+
+    // 密度网格 + 可分离高斯，代价与网格大小相关而不是逐框画渐变
+    engine->reset(bounds, QSize(kTargetWidth, heatHeight), 6.0);
+}
+
+static QRectF detectionBounds(const DetectionResult& result) {
+    if (result.isEmpty()) return QRectF();
+    const float* xs = result.xData();
+    const float* ys = result.yData();
+    const float* ws = result.widthData();
+    const float* hs = result.heightData();
+    float left = xs[0], top = ys[0], right = xs[0] + ws[0], bottom = ys[0] + hs[0];
+    for (int i = 1; i < result.count(); ++i) {
+        left = std::min(left, xs[i]);
+        top = std::min(top, ys[i]);
+        right = std::max(right, xs[i] + ws[i]);
+        bottom = std::max(bottom, ys[i] + hs[i]);
+    }
+    return QRectF(QPointF(left, top), QPointF(right, bottom));
+}
+
+static QImage renderHeatmapPanel(const HeatmapEngine& engine) {
+    QImage heatmap(engine.gridSize(), QImage::Format_ARGB32_Premultiplied);
+    heatmap.fill(QColor(30, 30, 30, 255));
+    QPainter painter(&heatmap);
+    painter.drawImage(0, 0, engine.render());
+    painter.end();
+    return heatmap;
+}
+
+namespace {
+struct HeatmapPanel {
+    HeatmapEngine engine;
+    QImage image;
+};
+} // namespace
+
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent), ui(new Ui::MainWindow)
 {
@@ -129,11 +190,57 @@ MainWindow::MainWindow(QWidget* parent)
         fileMenu->addAction(actSave);
         fileMenu->addAction(actLoad);
         runMenu->addAction(actRun);
+        auto* actClear = new QAction(QStringLiteral("清除识别结果"), this);
+        runMenu->addAction(actClear);
+        connect(actClear, &QAction::triggered, this, &MainWindow::clearResults);
+
+        // 分块识别：整片或当前视口区域，结果边识别边显示
+        auto* actSlide = new QAction(QStringLiteral("整片分块识别…"), this);
+        auto* actRoi   = new QAction(QStringLiteral("分块识别（当前视口区域）"), this);
+        m_actPauseJob  = new QAction(QStringLiteral("暂停分块识别"), this);
+        m_actPauseJob->setCheckable(true);
+        m_actPauseJob->setEnabled(false);
+        m_actCancelJob = new QAction(QStringLiteral("取消分块识别"), this);
+        m_actCancelJob->setEnabled(false);
+        runMenu->addSeparator();
+        runMenu->addAction(actSlide);
+        runMenu->addAction(actRoi);
+        runMenu->addAction(m_actPauseJob);
+        runMenu->addAction(m_actCancelJob);
+        connect(actSlide, &QAction::triggered, this, &MainWindow::runSlideInference);
+        connect(actRoi,   &QAction::triggered, this, &MainWindow::runRoiInference);
+        connect(m_actPauseJob, &QAction::toggled, this, [this](bool paused) {
+            if (!m_job) return;
+            if (paused) {
+                m_job->pause();
+            } else {
+                m_job->resume();
+            }
+        });
+        connect(m_actCancelJob, &QAction::triggered, this, &MainWindow::stopTiledInference);
 
         connect(actOpen, &QAction::triggered, this, &MainWindow::openWSI);
         connect(actRun,  &QAction::triggered, this, &MainWindow::runInferenceOnViewport);
         connect(actSave, &QAction::triggered, this, &MainWindow::saveResults);
         connect(actLoad, &QAction::triggered, this, &MainWindow::loadResults);
+
+        // 视图：切片上的热力图叠加层
+        QMenu* viewMenu = menuBar()->addMenu(QStringLiteral("视图"));
+        viewMenu->setObjectName("menuView");
+        auto* actHeatmap = new QAction(QStringLiteral("显示热力图叠加"), this);
+        actHeatmap->setCheckable(true);
+        auto* actOpacity = new QAction(QStringLiteral("热力图透明度…"), this);
+        viewMenu->addAction(actHeatmap);
+        viewMenu->addAction(actOpacity);
+        connect(actHeatmap, &QAction::toggled, m_view, &WSIView::setHeatmapVisible);
+        connect(actOpacity, &QAction::triggered, this, [this]() {
+            bool ok = false;
+            const int percent = QInputDialog::getInt(this, QStringLiteral("热力图透明度"), QStringLiteral("不透明度（%）"),
+                                                     qRound(m_view->heatmapOpacity() * 100.0), 0, 100, 5, &ok);
+            if (ok) {
+                m_view->setHeatmapOpacity(percent / 100.0);
+            }
+        });
     }
 
     // 视口变化时更新状态
@@ -148,7 +255,44 @@ MainWindow::MainWindow(QWidget* parent)
         }
     });
     connect(m_miniMap, &MiniMapWidget::requestCenterOn, m_view, &WSIView::centerOnWorld);
+    connect(m_infer.get(), &InferenceClient::finished, this,
+            [this](quint64 id, const ViewportMeta&, const QVector<DetBox>& boxes) { handleViewportResult(id, boxes); });
+    connect(m_infer.get(), &InferenceClient::failed, this, [this](quint64 id, const ViewportMeta&, const QString& message) {
+        if (m_viewportRequests.remove(id) > 0) {
+            statusBar()->showMessage(QStringLiteral("识别失败：%1").arg(message));
+        }
+    });
+    connect(m_view, &WSIView::detectionClicked, this, [this](int index) {
+        // 下标对应视图当前显示的结果，它可能比 m_result 晚一次刷新
+        const DetectionResult& shown = m_view->detections();
+        if (index < 0 || index >= shown.count()) return;
+        const DetBox box = shown.box(index);
+        const QString label = box.label.isEmpty() ? QStringLiteral("未标注") : box.label;
+        statusBar()->showMessage(QStringLiteral("#%1 %2 置信度: %3 区域: [x=%4, y=%5, w=%6, h=%7]")
+                                     .arg(index + 1)
+                                     .arg(label)
+                                     .arg(box.score, 0, 'f', 2)
+                                     .arg(box.rect.x(), 0, 'f', 0)
+                                     .arg(box.rect.y(), 0, 'f', 0)
+                                     .arg(box.rect.width(), 0, 'f', 0)
+                                     .arg(box.rect.height(), 0, 'f', 0));
+    });
+
 
+    // 分块识别进度
+    m_jobProgress = new QProgressBar(this);
+    m_jobProgress->setMaximumWidth(220);
+    m_jobProgress->setFormat(QStringLiteral("分块识别 %v/%m"));
+    m_jobProgress->setVisible(false);
+    statusBar()->addPermanentWidget(m_jobProgress);
+    m_fileProgress = new QProgressBar(this);
+    m_fileProgress->setMaximumWidth(220);
+    m_fileProgress->setRange(0, DetectionResultIO::kProgressRange);
+    m_fileProgress->setVisible(false);
+    statusBar()->addPermanentWidget(m_fileProgress);
+    m_streamRefresh.setSingleShot(true);
+    m_streamRefresh.setInterval(500);
+    connect(&m_streamRefresh, &QTimer::timeout, this, &MainWindow::refreshStreamedResults);
 
     statusBar()->showMessage(QStringLiteral("准备就绪（后端：%1）").arg(backendBase.toString()));
 
@@ -163,6 +307,8 @@ void MainWindow::openWSI() {
     const QString path = QFileDialog::getOpenFileName(this, QStringLiteral("打开 WSI/图像"), QString(), filters);
     if (path.isEmpty()) return;
 
+    stopTiledInference();
+    cancelViewportInference();
     if (!m_handler->open(path)) {
         QMessageBox::warning(this, QStringLiteral("打开失败"), QStringLiteral("无法打开文件：%1").arg(path));
         return;
@@ -176,9 +322,10 @@ void MainWindow::openWSI() {
         return;
     }
 
+    ++m_resultEpoch;
     m_result.clear();
     m_view->setSlideInfo(downsamples, levelSizes);
-    m_view->setDetections(m_result.boxes());
+    m_view->setDetections(m_result);
     updateDetectionDetails();
     updateHeatmapVisualization();
     m_currentLevel = m_view->currentLevel();
@@ -200,11 +347,6 @@ void MainWindow::runInferenceOnViewport() {
         QMessageBox::warning(this, QStringLiteral("提示"), QStringLiteral("后端切片尚未打开"));
         return;
     }
-    const QImage viewport = m_view->grabViewportImage();
-    if (viewport.isNull()) {
-        QMessageBox::warning(this, QStringLiteral("抓取失败"), QStringLiteral("无法获取视口图像"));
-        return;
-    }
 
     ViewportMeta meta;
     meta.slideId = m_handler->slideId();
@@ -217,42 +359,159 @@ void MainWindow::runInferenceOnViewport() {
     }
     const double downsample = m_handler->levelDownsample(meta.level);
     const double safeDown = downsample > 0.0 ? downsample : 1.0;
-    meta.originX = worldRect.left() / safeDown;
-    meta.originY = worldRect.top() / safeDown;
+    // 直接用当前层级的原始像素（按识别格式无损读取），不含叠加层，与窗口大小和缩放无关
+    const QRect levelRect = QRectF(worldRect.left() / safeDown, worldRect.top() / safeDown,
+                                   worldRect.width() / safeDown, worldRect.height() / safeDown)
+                                .toAlignedRect()
+                                .intersected(QRect(QPoint(0, 0), m_handler->levelSize(meta.level)));
+    meta.originX = levelRect.x();
+    meta.originY = levelRect.y();
+    meta.downsample = safeDown;
+    const QRectF region(levelRect.x() * safeDown, levelRect.y() * safeDown,
+                        levelRect.width() * safeDown, levelRect.height() * safeDown);
+
+    // 读像素与识别都是异步的，等待期间可以继续浏览并对其他区域发起识别
+    const quint64 epoch = m_viewportEpoch;
+    m_handler->readLevelRegionAsync(meta.level, levelRect, TileUsage::Analysis).then(this, [this, meta, region, epoch](const QImage& viewport) {
+        if (epoch != m_viewportEpoch) return;
+        if (viewport.isNull()) {
+            statusBar()->showMessage(QStringLiteral("无法获取视口图像"));
+            return;
+        }
+        const quint64 id = m_infer->submit(viewport, meta);
+        if (id == 0) return;
+        m_viewportRequests.insert(id, region);
+        statusBar()->showMessage(QStringLiteral("识别中……（%1 个区域等待结果）").arg(m_viewportRequests.size()));
+    });
+}
 
+void MainWindow::handleViewportResult(quint64 id, const QVector<DetBox>& boxes) {
+    const auto it = m_viewportRequests.constFind(id);
+    if (it == m_viewportRequests.constEnd()) return;
+    const QRectF region = it.value();
+    m_viewportRequests.erase(it);
 
-    const QVector<DetBox> boxes = m_infer->analyzeViewport(viewport, meta);
+    replaceRegion(region, boxes);
+    // 分块识别的合并结果稍后会整体替换 m_result，记下这次修改以便之后重放
+    if (m_viewportEditsEpoch != 0 && m_viewportEditsEpoch == m_resultEpoch) {
+        m_viewportEdits.push_back({region, boxes});
+    }
 
-    m_result.setBoxes(boxes);
-    m_view->setDetections(m_result.boxes());
+    m_view->setDetections(m_result);
     updateDetectionDetails();
     updateHeatmapVisualization();
     updateStatus();
 }
 
-void MainWindow::saveResults() {
-    const QString out = QFileDialog::getSaveFileName(this, QStringLiteral("保存识别结果 JSON"), QString(), QStringLiteral("JSON (*.json)"));
-    if (out.isEmpty()) return;
-    if (!m_result.saveToJson(out)) {
-        QMessageBox::warning(this, QStringLiteral("保存失败"), QStringLiteral("无法保存 JSON：%1").arg(out));
-        return;
+void MainWindow::replaceRegion(const QRectF& region, const QVector<DetBox>& boxes) {
+    // 同一区域重复识别时以新结果为准，区域外已有的结果保留
+    QVector<int> kept;
+    kept.reserve(m_result.count());
+    for (int i = 0; i < m_result.count(); ++i) {
+        if (!region.contains(m_result.center(i))) {
+            kept.push_back(i);
+        }
     }
-    statusBar()->showMessage(QStringLiteral("已保存：%1").arg(out));
+    if (kept.size() != m_result.count()) {
+        m_result = m_result.subset(kept);
+    }
+    m_result.appendBoxes(boxes);
 }
 
-void MainWindow::loadResults() {
-    const QString in = QFileDialog::getOpenFileName(this, QStringLiteral("加载识别结果 JSON"), QString(), QStringLiteral("JSON (*.json)"));
-    if (in.isEmpty()) return;
-    if (!m_result.loadFromJson(in)) {
-        QMessageBox::warning(this, QStringLiteral("加载失败"), QStringLiteral("无法解析 JSON：%1").arg(in));
-        return;
+void MainWindow::cancelViewportInference() {
+    ++m_viewportEpoch;
+    for (auto it = m_viewportRequests.constBegin(); it != m_viewportRequests.constEnd(); ++it) {
+        m_infer->cancel(it.key());
     }
-    m_view->setDetections(m_result.boxes());
+    m_viewportRequests.clear();
+}
+
+void MainWindow::clearResults() {
+    stopTiledInference();
+    cancelViewportInference();
+    ++m_resultEpoch;
+    m_result.clear();
+    m_view->setDetections(m_result);
     updateDetectionDetails();
     updateHeatmapVisualization();
     updateStatus();
 }
 
+void MainWindow::saveResults() {
+    QString selectedFilter;
+    QString out = QFileDialog::getSaveFileName(this, QStringLiteral("保存识别结果"), QString(),
+                                               QStringLiteral("检测结果 (*.wdet);;JSON (*.json)"), &selectedFilter);
+    if (out.isEmpty()) return;
+    if (QFileInfo(out).suffix().isEmpty()) {
+        out += selectedFilter.startsWith(QLatin1String("JSON")) ? QStringLiteral(".json") : QStringLiteral(".wdet");
+    }
+
+    // 保存的是当前结果的共享副本，之后继续识别或清除都不影响写出的内容
+    DetectionResult snapshot = m_result;
+    if (snapshot.imageSize().isEmpty() && m_handler->isOpen()) {
+        snapshot.setImageSize(m_handler->levelSize(0));
+    }
+    runFileTask(DetectionResultIO::saveAsync(snapshot, out), QStringLiteral("保存结果 %p%"),
+                [this, out](const DetectionResultIO::Outcome& outcome) {
+                    if (!outcome.ok) {
+                        QMessageBox::warning(this, QStringLiteral("保存失败"), outcome.error);
+                        return;
+                    }
+                    statusBar()->showMessage(QStringLiteral("已保存：%1").arg(out));
+                });
+}
+
+void MainWindow::loadResults() {
+    const QString in = QFileDialog::getOpenFileName(this, QStringLiteral("加载识别结果"), QString(),
+                                                    QStringLiteral("检测结果 (*.wdet *.json);;所有文件 (*)"));
+    if (in.isEmpty()) return;
+    stopTiledInference();
+    cancelViewportInference();
+    // 结果在加载完成时才整体替换；期间换片、清除或再次加载都会使这次加载作废
+    const quint64 epoch = ++m_resultEpoch;
+    m_loadTask.cancel();
+    m_loadTask = DetectionResultIO::loadAsync(in);
+    statusBar()->showMessage(QStringLiteral("正在加载：%1").arg(in));
+    runFileTask(m_loadTask, QStringLiteral("加载结果 %p%"),
+                [this, epoch, in](const DetectionResultIO::Outcome& outcome) {
+                    if (epoch != m_resultEpoch) return;
+                    if (!outcome.ok) {
+                        QMessageBox::warning(this, QStringLiteral("加载失败"),
+                                             QStringLiteral("%1\n%2").arg(in, outcome.error));
+                        return;
+                    }
+                    m_result = outcome.result;
+                    m_view->setDetections(m_result);
+                    updateDetectionDetails();
+                    updateHeatmapVisualization();
+                    updateStatus();
+                    statusBar()->showMessage(QStringLiteral("已加载 %1 个目标：%2").arg(m_result.count()).arg(in));
+                });
+}
+
+void MainWindow::runFileTask(const QFuture<DetectionResultIO::Outcome>& task, const QString& format,
+                             std::function<void(const DetectionResultIO::Outcome&)> done) {
+    using Watcher = QFutureWatcher<DetectionResultIO::Outcome>;
+    auto* watcher = new Watcher(this);
+    ++m_fileTasks;
+    m_fileProgress->setFormat(format);
+    m_fileProgress->setValue(0);
+    m_fileProgress->setVisible(true);
+    connect(watcher, &Watcher::progressValueChanged, m_fileProgress, &QProgressBar::setValue);
+    connect(watcher, &Watcher::finished, this, [this, watcher, done = std::move(done)]() {
+        watcher->deleteLater();
+        if (--m_fileTasks == 0) {
+            m_fileProgress->setVisible(false);
+        }
+        const QFuture<DetectionResultIO::Outcome> future = watcher->future();
+        if (future.isCanceled() || future.resultCount() == 0) return;
+        const DetectionResultIO::Outcome outcome = future.result();
+        if (outcome.canceled) return;
+        done(outcome);
+    });
+    watcher->setFuture(task);
+}
+
 void MainWindow::updateDetectionDetails() {
     if (!ui || !ui->resultTextEdit) return;
 
@@ -261,13 +520,16 @@ void MainWindow::updateDetectionDetails() {
         return;
     }
 
+    // 整片识别可能有数十万个框，文本框只列出前面一部分
+    constexpr int kMaxListed = 500;
+    const int listed = std::min(m_result.count(), kMaxListed);
     QStringList lines;
-    lines.reserve(m_result.count());
-    int index = 1;
-    for (const auto& box : m_result.boxes()) {
+    lines.reserve(listed + 1);
+    for (int i = 0; i < listed; ++i) {
+        const DetBox box = m_result.box(i);
         const QString label = box.label.isEmpty() ? QStringLiteral("未标注") : box.label;
         lines << QStringLiteral("#%1 %2 置信度: %3\n区域: [x=%4, y=%5, w=%6, h=%7]")
-                     .arg(index++)
+                     .arg(i + 1)
                      .arg(label)
                      .arg(box.score, 0, 'f', 2)
                      .arg(box.rect.x(), 0, 'f', 0)
@@ -276,77 +538,197 @@ void MainWindow::updateDetectionDetails() {
                      .arg(box.rect.height(), 0, 'f', 0);
     }
 
+    if (m_result.count() > listed) {
+        lines << QStringLiteral("……共 %1 个目标，其余 %2 个未列出").arg(m_result.count()).arg(m_result.count() - listed);
+    }
     ui->resultTextEdit->setPlainText(lines.join(QStringLiteral("\n\n")));
 }
 
-void MainWindow::updateHeatmapVisualization() {
+void MainWindow::updateHeatmapVisualization(bool appended) {
     if (!ui || !ui->heatmapLabel) return;
 
     if (m_result.count() == 0) {
+        // 作废在途的重算
+        ++m_heatmapSerial;
+        m_heatmapDirty = false;
         ui->heatmapLabel->setPixmap(QPixmap());
         ui->heatmapLabel->setText(QStringLiteral("暂无热力图数据"));
         return;
     }
 
-    QRectF bounds;
-    bool firstBox = true;
-    for (const auto& box : m_result.boxes()) {
-        if (firstBox) {
-            bounds = box.rect;
-            firstBox = false;
-        } else {
-            bounds = bounds.united(box.rect);
-        }
+    if (appended && !m_heatmapBuilding && !m_heatmap.isEmpty() && m_heatmap.boxCount() <= m_result.count()) {
+        // 高斯是线性的，只累加新增的框
+        m_heatmap.addBoxes(m_result, m_heatmap.boxCount());
+        showHeatmap(renderHeatmapPanel(m_heatmap));
+        return;
     }
 
-    if (bounds.width() <= 0.0 || bounds.height() <= 0.0) {
-        bounds = QRectF(0.0, 0.0, 512.0, 512.0);
+    // 整体重算（加载、合并后可能有上百万个框）放到线程池，期间的变化合并为一次补算
+    m_heatmapDirty = true;
+    if (!m_heatmapBuilding) {
+        rebuildHeatmap();
     }
+}
 
-    const double marginX = std::max(bounds.width() * 0.1, 50.0);
-    const double marginY = std::max(bounds.height() * 0.1, 50.0);
-    bounds.adjust(-marginX, -marginY, marginX, marginY);
-    if (bounds.width() <= 0.0) bounds.setWidth(1.0);
-    if (bounds.height() <= 0.0) bounds.setHeight(1.0);
+void MainWindow::rebuildHeatmap() {
+    m_heatmapDirty = false;
+    m_heatmapBuilding = true;
+    const quint64 serial = m_heatmapSerial;
+    QtConcurrent::run([result = m_result]() {
+        HeatmapPanel panel;
+        configureHeatmap(&panel.engine, detectionBounds(result));
+        panel.engine.addBoxes(result);
+        panel.image = renderHeatmapPanel(panel.engine);
+        return panel;
+    }).then(this, [this, serial](const HeatmapPanel& panel) {
+        m_heatmapBuilding = false;
+        if (serial == m_heatmapSerial) {
+            m_heatmap = panel.engine;
+            showHeatmap(panel.image);
+        }
+        if (m_heatmapDirty) {
+            rebuildHeatmap();
+        }
+    });
+}
 
-    constexpr int kTargetWidth = 420;
-    int heatHeight = static_cast<int>(std::round(bounds.height() / bounds.width() * kTargetWidth));
-    if (heatHeight <= 0) {
-        heatHeight = kTargetWidth;
+void MainWindow::showHeatmap(const QImage& image) {
+    ui->heatmapLabel->setText(QString());
+    ui->heatmapLabel->setPixmap(QPixmap::fromImage(image));
+}
+
+void MainWindow::resetHeatmap(QRectF bounds) {
+    configureHeatmap(&m_heatmap, bounds);
+}
+
+void MainWindow::runSlideInference() {
+    if (!m_handler || !m_handler->isOpen() || m_view->isEmpty()) {
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先打开 WSI 文件。"));
+        return;
     }
-    heatHeight = std::clamp(heatHeight, 160, 720);
 
-    QImage heatmap(kTargetWidth, heatHeight, QImage::Format_ARGB32_Premultiplied);
-    heatmap.fill(QColor(30, 30, 30, 255));
+    const QVector<QSize> levelSizes = m_handler->levelSizes();
+    QStringList items;
+    for (int i = 0; i < levelSizes.size(); ++i) {
+        items << QStringLiteral("Level %1（%2 × %3）").arg(i).arg(levelSizes[i].width()).arg(levelSizes[i].height());
+    }
+    bool ok = false;
+    const QString choice = QInputDialog::getItem(this, QStringLiteral("整片分块识别"), QStringLiteral("识别所用层级"),
+                                                 items, std::clamp(m_view->currentLevel(), 0, int(items.size()) - 1),
+                                                 false, &ok);
+    if (!ok || choice.isEmpty()) return;
 
-    QPainter painter(&heatmap);
-    painter.setRenderHint(QPainter::Antialiasing, true);
-
-    const double scaleX = static_cast<double>(kTargetWidth) / bounds.width();
-    const double scaleY = static_cast<double>(heatHeight) / bounds.height();
-
-    for (const auto& box : m_result.boxes()) {
-        const QPointF center = box.rect.center();
-        const QPointF mapped((center.x() - bounds.left()) * scaleX, (center.y() - bounds.top()) * scaleY);
-        const double radiusX = box.rect.width() * scaleX * 0.5;
-        const double radiusY = box.rect.height() * scaleY * 0.5;
-        double radiusPx = std::max(18.0, std::max(radiusX, radiusY));
-        radiusPx = std::min(radiusPx, std::max(kTargetWidth, heatHeight) * 0.75);
-        const double weight = std::clamp(box.score, 0.0, 1.0);
-        QRadialGradient gradient(mapped, radiusPx);
-        gradient.setColorAt(0.0, QColor(255, 255, 0, static_cast<int>(200 * weight + 55)));
-        gradient.setColorAt(0.45, QColor(255, 140, 0, static_cast<int>(170 * weight + 40)));
-        gradient.setColorAt(0.9, QColor(255, 0, 0, static_cast<int>(100 * weight + 25)));
-        gradient.setColorAt(1.0, QColor(0, 0, 0, 0));
-        painter.setPen(Qt::NoPen);
-        painter.setBrush(gradient);
-        painter.drawEllipse(mapped, radiusPx, radiusPx);
+    startTiledInference(items.indexOf(choice), QRect());
+}
+
+void MainWindow::runRoiInference() {
+    if (!m_handler || !m_handler->isOpen() || m_view->isEmpty()) {
+        QMessageBox::information(this, QStringLiteral("提示"), QStringLiteral("请先打开 WSI 文件。"));
+        return;
+    }
+    const QRectF worldRect = m_view->viewWorldRect();
+    if (worldRect.isEmpty()) {
+        QMessageBox::warning(this, QStringLiteral("提示"), QStringLiteral("当前视口区域无效"));
+        return;
     }
 
-    painter.end();
+    const int level = m_view->currentLevel();
+    const double downsample = m_handler->levelDownsample(level);
+    const double safeDown = downsample > 0.0 ? downsample : 1.0;
+    const QRectF levelRect(worldRect.left() / safeDown, worldRect.top() / safeDown,
+                           worldRect.width() / safeDown, worldRect.height() / safeDown);
+    startTiledInference(level, levelRect.toAlignedRect());
+}
 
-    ui->heatmapLabel->setText(QString());
-    ui->heatmapLabel->setPixmap(QPixmap::fromImage(heatmap));
+void MainWindow::startTiledInference(int level, const QRect& levelRect) {
+    stopTiledInference();
+
+    SlideInferenceJob::Config config;
+    config.level = level;
+    config.levelRect = levelRect;
+    m_job = new SlideInferenceJob(m_handler.get(), m_infer.get(), config, this);
+
+    // 新一轮识别从空结果开始，热力图范围固定为识别区域，便于逐批累加
+    const double downsample = m_handler->levelDownsample(level);
+    const double safeDown = downsample > 0.0 ? downsample : 1.0;
+    const QRect area = levelRect.isEmpty() ? QRect(QPoint(0, 0), m_handler->levelSize(level)) : levelRect;
+    ++m_resultEpoch;
+    m_result.clear();
+    m_viewportEdits.clear();
+    m_viewportEditsEpoch = m_resultEpoch;
+    m_view->setDetections(m_result);
+    updateDetectionDetails();
+    updateHeatmapVisualization();
+    resetHeatmap(QRectF(area.x() * safeDown, area.y() * safeDown, area.width() * safeDown, area.height() * safeDown));
+
+    connect(m_job, &SlideInferenceJob::boxesReady, this, [this](const QVector<DetBox>& boxes) {
+        m_result.appendBoxes(boxes);
+        if (!m_streamRefresh.isActive()) {
+            m_streamRefresh.start();
+        }
+    });
+    connect(m_job, &SlideInferenceJob::progressChanged, this, [this](int completed, int total) {
+        m_jobProgress->setMaximum(std::max(1, total));
+        m_jobProgress->setValue(completed);
+    });
+    connect(m_job, &SlideInferenceJob::finished, this, [this, job = m_job](bool canceled) {
+        m_streamRefresh.stop();
+        refreshStreamedResults();
+        m_jobProgress->setVisible(false);
+        m_actPauseJob->setChecked(false);
+        m_actPauseJob->setEnabled(false);
+        m_actCancelJob->setEnabled(false);
+        QString msg = canceled ? QStringLiteral("分块识别已取消：完成 %1/%2 块").arg(job->completedTiles()).arg(job->totalTiles())
+                               : QStringLiteral("分块识别完成：共 %1 块").arg(job->totalTiles());
+        if (job->failedTiles() > 0) {
+            msg += QStringLiteral("，其中 %1 块读取失败").arg(job->failedTiles());
+        }
+        msg += QStringLiteral("，检测目标 %1 个").arg(m_result.count());
+        statusBar()->showMessage(msg + QStringLiteral("，正在合并块间重复……"));
+        job->deleteLater();
+
+        // 相邻块重叠处的重复框在后台做一次并行 NMS，完成后替换结果，
+        // 再重放期间到达的视口识别结果，使它们不被合并结果覆盖
+        const DetectionMerger merger = job->merger();
+        const quint64 epoch = m_resultEpoch;
+        QtConcurrent::run([merger]() { return merger.merge(DetectionMerger::Options()); })
+            .then(this, [this, epoch, msg](const DetectionResult& merged) {
+                if (epoch != m_resultEpoch) return;
+                const int before = m_result.count();
+                m_result = merged;
+                for (const auto& edit : std::as_const(m_viewportEdits)) {
+                    replaceRegion(edit.first, edit.second);
+                }
+                m_viewportEdits.clear();
+                m_viewportEditsEpoch = 0;
+                const int removed = before - m_result.count();
+                m_view->setDetections(m_result);
+                updateDetectionDetails();
+                updateHeatmapVisualization();
+                updateStatus();
+                statusBar()->showMessage(msg + QStringLiteral("，合并重复 %1 个，剩余 %2 个").arg(removed).arg(m_result.count()));
+            });
+    });
+
+    m_jobProgress->setValue(0);
+    m_jobProgress->setVisible(true);
+    m_actPauseJob->setChecked(false);
+    m_actPauseJob->setEnabled(true);
+    m_actCancelJob->setEnabled(true);
+    m_job->start();
+}
+
+void MainWindow::stopTiledInference() {
+    if (m_job && m_job->isRunning()) {
+        m_job->cancel();
+    }
+}
+
+void MainWindow::refreshStreamedResults() {
+    m_view->setDetections(m_result);
+    updateDetectionDetails();
+    updateHeatmapVisualization(true);
+    updateStatus();
 }
 
 void MainWindow::updateStatus() {
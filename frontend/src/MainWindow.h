@@ -1,15 +1,27 @@
 #pragma once
 #include <QMainWindow>
 #include <QPointer>
+#include <QTimer>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <QRectF>
+#include <QFuture>
+#include <functional>
 #include <memory>
 
 #include "WSIHandler.h"
 #include "WSIView.h"
 #include "InferenceClient.h"
 #include "DetectionResult.h"
+#include "DetectionResultIO.h"
+#include "HeatmapEngine.h"
 
 class MiniMapWidget;
 class QDockWidget;
+class QProgressBar;
+class QAction;
+class SlideInferenceJob;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -24,6 +36,9 @@ public:
 private slots:
     void openWSI();
     void runInferenceOnViewport();
+    void runSlideInference();
+    void runRoiInference();
+    void clearResults();
     void saveResults();
     void loadResults();
     void updateStatus();
@@ -31,7 +46,21 @@ private slots:
 
 private:
     void updateDetectionDetails();
-    void updateHeatmapVisualization();
+    // appended 为 true 时只把新增的框累加进已有热力图
+    void updateHeatmapVisualization(bool appended = false);
+    void rebuildHeatmap();
+    void showHeatmap(const QImage& image);
+    void resetHeatmap(QRectF bounds);
+    void startTiledInference(int level, const QRect& levelRect);
+    void stopTiledInference();
+    void refreshStreamedResults();
+    void handleViewportResult(quint64 id, const QVector<DetBox>& boxes);
+    // 用 boxes 替换 m_result 中中心落在 region 内的框
+    void replaceRegion(const QRectF& region, const QVector<DetBox>& boxes);
+    void cancelViewportInference();
+    // 在后台读写结果文件，进度显示在状态栏；完成后在 GUI 线程回调 done（取消时不回调）
+    void runFileTask(const QFuture<DetectionResultIO::Outcome>& task, const QString& format,
+                     std::function<void(const DetectionResultIO::Outcome&)> done);
 
     Ui::MainWindow* ui{nullptr};
     std::unique_ptr<WSIHandler> m_handler;
@@ -40,6 +69,26 @@ private:
     MiniMapWidget* m_miniMap{nullptr};
     QDockWidget* m_miniMapDock{nullptr};
     DetectionResult m_result;
+    HeatmapEngine m_heatmap;
+    // 侧栏热力图的整体重算在线程池进行；serial 在结果清空时递增，作废在途的重算
+    quint64 m_heatmapSerial{0};
+    bool m_heatmapBuilding{false};
+    bool m_heatmapDirty{false};
+    QPointer<SlideInferenceJob> m_job;
+    QProgressBar* m_jobProgress{nullptr};
+    QProgressBar* m_fileProgress{nullptr};
+    int m_fileTasks{0};
+    QFuture<DetectionResultIO::Outcome> m_loadTask;
+    QAction* m_actPauseJob{nullptr};
+    QAction* m_actCancelJob{nullptr};
+    QTimer m_streamRefresh;     // 分块识别时合并界面刷新
+    QHash<quint64, QRectF> m_viewportRequests;  // 视口识别请求号 -> 对应的 level0 区域
+    quint64 m_viewportEpoch{0};
+    quint64 m_resultEpoch{0};   // 结果被整体替换（换片、加载、清除、重新识别）时递增
+    // 分块识别开始后到合并完成前的视口识别结果，合并结果替换 m_result 后按序重放；
+    // 仅当 m_viewportEditsEpoch 非 0 且等于 m_resultEpoch 时记录
+    QVector<QPair<QRectF, QVector<DetBox>>> m_viewportEdits;
+    quint64 m_viewportEditsEpoch{0};
     int m_currentLevel{0};
 };
 
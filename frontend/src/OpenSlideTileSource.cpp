@@ -0,0 +1,131 @@
+#include "OpenSlideTileSource.h"
+
+#include <QPromise>
+#include <QThread>
+#include <QFile>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#ifdef HAVE_OPENSLIDE
+#include <openslide.h>
+#endif
+
+// openslide_t 本身可被多线程并发读取；用 shared_ptr 保证在途读取结束前不被关闭
+struct OpenSlideTileSource::Slide {
+#ifdef HAVE_OPENSLIDE
+    openslide_t* osr{nullptr};
+    ~Slide() {
+        if (osr) openslide_close(osr);
+    }
+#endif
+    QVector<double> downsamples;
+    std::atomic<bool> closed{false};
+};
+
+OpenSlideTileSource::OpenSlideTileSource() {
+    m_readPool.setMaxThreadCount(std::max(2, QThread::idealThreadCount()));
+    m_readPool.setExpiryTimeout(3000);
+}
+
+OpenSlideTileSource::~OpenSlideTileSource() {
+    close();
+    m_readPool.waitForDone();
+}
+
+bool OpenSlideTileSource::isAvailable() {
+#ifdef HAVE_OPENSLIDE
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool OpenSlideTileSource::open(const QString& path, SlideInfo* info) {
+    close();
+    *info = SlideInfo();
+#ifdef HAVE_OPENSLIDE
+    const QByteArray native = QFile::encodeName(path);
+    openslide_t* osr = openslide_open(native.constData());
+    if (!osr) return false;
+    if (openslide_get_error(osr)) {
+        openslide_close(osr);
+        return false;
+    }
+
+    auto slide = std::make_shared<Slide>();
+    slide->osr = osr;
+    const int levels = openslide_get_level_count(osr);
+    for (int i = 0; i < levels; ++i) {
+        int64_t w = 0;
+        int64_t h = 0;
+        openslide_get_level_dimensions(osr, i, &w, &h);
+        info->levelDims.push_back(QSize(static_cast<int>(w), static_cast<int>(h)));
+        const double down = openslide_get_level_downsample(osr, i);
+        info->downsamples.push_back(down > 0.0 ? down : std::pow(2.0, i));
+    }
+    info->levelCount = info->levelDims.size();
+    if (info->levelCount <= 0) {
+        *info = SlideInfo();
+        return false;
+    }
+    slide->downsamples = info->downsamples;
+    m_slide = slide;
+    return true;
+#else
+    Q_UNUSED(path);
+    return false;
+#endif
+}
+
+void OpenSlideTileSource::close() {
+    // 排队中的读取看到 closed 后直接返回空图；在途读取持有 Slide 的引用，结束后才真正关闭
+    if (m_slide) {
+        m_slide->closed.store(true);
+    }
+    m_slide.reset();
+}
+
+QFuture<QImage> OpenSlideTileSource::readRegionAsync(const RegionRequest& region, TileUsage usage,
+                                                     const CancelToken& cancel) {
+    Q_UNUSED(usage);
+    auto promise = std::make_shared<QPromise<QImage>>();
+    QFuture<QImage> future = promise->future();
+    promise->start();
+
+    auto slide = m_slide;
+    if (!slide || cancel.isCanceled() || region.w <= 0 || region.h <= 0 || region.level < 0 || region.level >= slide->downsamples.size()) {
+        promise->addResult(QImage());
+        promise->finish();
+        return future;
+    }
+
+    // 单块读取无法中途打断；取消只让尚未开始的读取直接返回
+    m_readPool.start([promise, slide, region, cancel]() {
+        QImage out;
+#ifdef HAVE_OPENSLIDE
+        if (!promise->isCanceled() && !cancel.isCanceled() && !slide->closed.load()) {
+            // openslide 输出的就是预乘 ARGB（本机字节序），与 Format_ARGB32_Premultiplied 一致
+            out = QImage(region.w, region.h, QImage::Format_ARGB32_Premultiplied);
+            if (!out.isNull()) {
+                const double down = slide->downsamples[region.level];
+                const int64_t lx = static_cast<int64_t>(std::llround(region.x * down));
+                const int64_t ly = static_cast<int64_t>(std::llround(region.y * down));
+                openslide_read_region(slide->osr, reinterpret_cast<uint32_t*>(out.bits()),
+                                      lx, ly, region.level, region.w, region.h);
+                if (openslide_get_error(slide->osr)) {
+                    out = QImage();
+                }
+            }
+        }
+#else
+        Q_UNUSED(slide);
+        Q_UNUSED(region);
+        Q_UNUSED(cancel);
+#endif
+        promise->addResult(out);
+        promise->finish();
+    });
+    return future;
+}
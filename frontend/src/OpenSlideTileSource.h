@@ -0,0 +1,27 @@
+#pragma once
+#include "TileSource.h"
+
+#include <QThreadPool>
+
+#include <memory>
+
+// 进程内 OpenSlide：在工作线程上直接 openslide_read_region 到 QImage 缓冲区，
+// 省去后端的编码、HTTP 传输与解码。仅在编译时找到 libopenslide（HAVE_OPENSLIDE）时可用。
+class OpenSlideTileSource : public TileSource {
+public:
+    OpenSlideTileSource();
+    ~OpenSlideTileSource() override;
+
+    static bool isAvailable();
+
+    bool open(const QString& path, SlideInfo* info) override;
+    void close() override;
+    QFuture<QImage> readRegionAsync(const RegionRequest& region, TileUsage usage,
+                                    const CancelToken& cancel = CancelToken()) override;
+    bool isRemote() const override { return false; }
+
+private:
+    struct Slide;
+    std::shared_ptr<Slide> m_slide;
+    QThreadPool m_readPool;
+};
@@ -0,0 +1,146 @@
+#include "SlideInferenceJob.h"
+#include "WSIHandler.h"
+
+#include <algorithm>
+
+SlideInferenceJob::SlideInferenceJob(WSIHandler* handler, InferenceClient* client, const Config& config,
+                                     QObject* parent)
+    : QObject(parent), m_handler(handler), m_client(client), m_config(config) {
+    m_config.tileSize = std::max(64, m_config.tileSize);
+    m_config.overlap = std::clamp(m_config.overlap, 0, m_config.tileSize / 2);
+    m_config.concurrency = std::max(1, m_config.concurrency);
+    if (m_client) {
+        connect(m_client, &InferenceClient::finished, this, &SlideInferenceJob::onInferenceFinished);
+        connect(m_client, &InferenceClient::failed, this, &SlideInferenceJob::onInferenceFailed);
+    }
+}
+
+SlideInferenceJob::~SlideInferenceJob() {
+    // 析构时不再发 finished，接收方可能已在销毁中
+    if (m_running) abort();
+}
+
+void SlideInferenceJob::start() {
+    if (m_running || !m_handler || !m_handler->isOpen() || !m_client) return;
+
+    const QSize levelSize = m_handler->levelSize(m_config.level);
+    const QRect levelBounds(QPoint(0, 0), levelSize);
+    const QRect area = m_config.levelRect.isEmpty() ? levelBounds : m_config.levelRect.intersected(levelBounds);
+
+    m_pending.clear();
+    const int step = m_config.tileSize - m_config.overlap;
+    if (!area.isEmpty()) {
+        for (qint64 y = area.top(); y <= area.bottom(); y += step) {
+            const int h = static_cast<int>(std::min<qint64>(m_config.tileSize, area.bottom() + 1 - y));
+            for (qint64 x = area.left(); x <= area.right(); x += step) {
+                const int w = static_cast<int>(std::min<qint64>(m_config.tileSize, area.right() + 1 - x));
+                m_pending.push_back({m_config.level, x, y, w, h});
+                if (x + w > area.right()) break;
+            }
+            if (y + h > area.bottom()) break;
+        }
+    }
+    m_total = static_cast<int>(m_pending.size());
+    m_completed = 0;
+    m_failed = 0;
+    m_merger.clear();
+    m_running = true;
+    m_paused = false;
+    // 读像素与识别在同一条流水线上，客户端的并发不能小于本任务的在途块数
+    m_client->setMaxConcurrent(std::max(m_client->maxConcurrent(), m_config.concurrency));
+
+    emit progressChanged(0, m_total);
+    pump();
+}
+
+void SlideInferenceJob::pause() {
+    if (!m_running) return;
+    m_paused = true;
+}
+
+void SlideInferenceJob::resume() {
+    if (!m_running || !m_paused) return;
+    m_paused = false;
+    pump();
+}
+
+void SlideInferenceJob::cancel() {
+    if (!m_running) return;
+    abort();
+    emit finished(true);
+}
+
+void SlideInferenceJob::abort() {
+    m_running = false;
+    m_pending.clear();
+    m_cancel.cancel();
+    if (m_client) {
+        for (quint64 id : std::as_const(m_requests)) {
+            m_client->cancel(id);
+        }
+    }
+    m_requests.clear();
+}
+
+void SlideInferenceJob::pump() {
+    while (m_running && !m_paused && m_inFlight < m_config.concurrency && !m_pending.empty()) {
+        const RegionRequest region = m_pending.front();
+        m_pending.pop_front();
+        submit(region);
+    }
+    if (m_running && m_inFlight == 0 && m_pending.empty()) {
+        m_running = false;
+        emit finished(false);
+    }
+}
+
+void SlideInferenceJob::submit(const RegionRequest& region) {
+    ViewportMeta meta;
+    meta.slideId = m_handler->slideId();
+    meta.level = region.level;
+    meta.originX = static_cast<double>(region.x);
+    meta.originY = static_cast<double>(region.y);
+    meta.downsample = m_handler->levelDownsample(region.level);
+
+    ++m_inFlight;
+    m_handler->requestRegionsAsync({region}, TileUsage::Analysis, m_cancel)
+        .value(0)
+        .then(this, [this, meta](const QImage& image) {
+            if (!m_running) {
+                --m_inFlight;
+                return;
+            }
+            const quint64 id = (image.isNull() || !m_client) ? 0 : m_client->submit(image, meta);
+            if (id == 0) {
+                tileDone(false, {});
+                return;
+            }
+            m_requests.insert(id);
+        });
+}
+
+void SlideInferenceJob::onInferenceFinished(quint64 id, const ViewportMeta& meta, const QVector<DetBox>& boxes) {
+    Q_UNUSED(meta);
+    if (!m_requests.remove(id)) return;
+    tileDone(true, boxes);
+}
+
+void SlideInferenceJob::onInferenceFailed(quint64 id, const ViewportMeta& meta, const QString& message) {
+    Q_UNUSED(meta);
+    Q_UNUSED(message);
+    if (!m_requests.remove(id)) return;
+    tileDone(false, {});
+}
+
+void SlideInferenceJob::tileDone(bool ok, const QVector<DetBox>& boxes) {
+    --m_inFlight;
+    if (!m_running) return;
+    ++m_completed;
+    if (!ok) ++m_failed;
+    if (!boxes.isEmpty()) {
+        m_merger.addRegion(boxes);
+        emit boxesReady(boxes);
+    }
+    emit progressChanged(m_completed, m_total);
+    pump();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <QObject>
+#include <QRect>
+#include <QVector>
+#include <QSet>
+#include <QPointer>
+
+#include <deque>
+
+#include "DetectionResult.h"
+#include "DetectionMerger.h"
+#include "InferenceClient.h"
+#include "TileSource.h"
+
+class WSIHandler;
+
+// 整片 / ROI 分块识别：在指定 level 上按网格切块，读像素、送后端识别，
+// 同时在途的块数不超过 concurrency。结果按块完成顺序逐批发出（level0 坐标）。
+// 对象只在 GUI 线程使用；像素读取与识别请求都是异步的，不阻塞界面。
+class SlideInferenceJob : public QObject {
+    Q_OBJECT
+public:
+    struct Config {
+        int level{0};
+        QRect levelRect;        // level 像素坐标；为空表示整层
+        int tileSize{1024};     // 送检块边长
+        int overlap{64};        // 相邻块重叠的像素数，边界上的目标至少在一块中完整出现
+        int concurrency{4};
+    };
+
+    SlideInferenceJob(WSIHandler* handler, InferenceClient* client, const Config& config,
+                      QObject* parent = nullptr);
+    ~SlideInferenceJob() override;
+
+    void start();
+    // 暂停只是不再提交新块，已在途的块照常完成
+    void pause();
+    void resume();
+    // 未开始的像素读取与识别请求立即取消，已发出的网络请求被中断
+    void cancel();
+
+    bool isRunning() const { return m_running; }
+    bool isPaused() const { return m_paused; }
+    int totalTiles() const { return m_total; }
+    int completedTiles() const { return m_completed; }
+    int failedTiles() const { return m_failed; }
+    const Config& config() const { return m_config; }
+    // 按块收集的全部结果；块间重叠造成的重复由 merge() 去除
+    const DetectionMerger& merger() const { return m_merger; }
+
+signals:
+    void boxesReady(const QVector<DetBox>& boxes);
+    void progressChanged(int completed, int total);
+    void finished(bool canceled);
+
+private:
+    void abort();
+    void pump();
+    void submit(const RegionRequest& region);
+    void tileDone(bool ok, const QVector<DetBox>& boxes);
+    void onInferenceFinished(quint64 id, const ViewportMeta& meta, const QVector<DetBox>& boxes);
+    void onInferenceFailed(quint64 id, const ViewportMeta& meta, const QString& message);
+
+    WSIHandler* m_handler{nullptr};
+    QPointer<InferenceClient> m_client;
+    QSet<quint64> m_requests;   // 本任务提交给 m_client 的请求号
+    Config m_config;
+    DetectionMerger m_merger;
+    CancelToken m_cancel;
+    std::deque<RegionRequest> m_pending;
+    int m_inFlight{0};
+    int m_total{0};
+    int m_completed{0};
+    int m_failed{0};
+    bool m_running{false};
+    bool m_paused{false};
+};
@@ -0,0 +1,155 @@
+#include "TileCache.h"
+
+#include <QHashFunctions>
+
+#include <algorithm>
+
+TileCache::TileCache(qint64 byteBudget) : m_budget(std::max<qint64>(0, byteBudget)) {}
+
+TileCache::~TileCache() {
+    clear();
+}
+
+QImage TileCache::find(const TileKey& key) {
+    auto it = m_index.constFind(key);
+    if (it == m_index.constEnd()) {
+        ++m_levelStats[key.level].misses;
+        return QImage();
+    }
+    Node* node = it.value();
+    ++m_levelStats[key.level].hits;
+    if (node != m_head) {
+        unlink(node);
+        pushFront(node);
+    }
+    return node->image;
+}
+
+QImage TileCache::peek(const TileKey& key) const {
+    const Node* node = m_index.value(key, nullptr);
+    return node ? node->image : QImage();
+}
+
+void TileCache::insert(const TileKey& key, const QImage& image) {
+    if (image.isNull()) return;
+    const qint64 cost = std::max<qint64>(1, image.sizeInBytes());
+
+    LevelStats& stats = m_levelStats[key.level];
+    ++stats.insertions;
+
+    if (Node* existing = m_index.value(key, nullptr)) {
+        stats.bytes += cost - existing->cost;
+        m_bytes += cost - existing->cost;
+        existing->image = image;
+        existing->cost = cost;
+        if (existing != m_head) {
+            unlink(existing);
+            pushFront(existing);
+        }
+    } else {
+        auto* node = new Node{key, image, cost};
+        m_index.insert(key, node);
+        pushFront(node);
+        stats.bytes += cost;
+        ++stats.tiles;
+        m_bytes += cost;
+    }
+    evictToBudget();
+}
+
+bool TileCache::remove(const TileKey& key) {
+    Node* node = m_index.take(key);
+    if (!node) return false;
+    unlink(node);
+    release(node, false);
+    return true;
+}
+
+int TileCache::removeIf(const std::function<bool(const TileKey& key)>& pred) {
+    int removed = 0;
+    Node* node = m_head;
+    while (node) {
+        Node* next = node->next;
+        if (pred(node->key)) {
+            m_index.remove(node->key);
+            unlink(node);
+            release(node, false);
+            ++removed;
+        }
+        node = next;
+    }
+    return removed;
+}
+
+void TileCache::clear() {
+    Node* node = m_head;
+    while (node) {
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+    m_head = m_tail = nullptr;
+    m_index.clear();
+    m_bytes = 0;
+    for (auto& stats : m_levelStats) {
+        stats.bytes = 0;
+        stats.tiles = 0;
+    }
+}
+
+void TileCache::setByteBudget(qint64 bytes) {
+    m_budget = std::max<qint64>(0, bytes);
+    evictToBudget();
+}
+
+void TileCache::resetStats() {
+    for (auto& stats : m_levelStats) {
+        stats.hits = stats.misses = stats.insertions = stats.evictions = 0;
+    }
+}
+
+void TileCache::unlink(Node* node) {
+    if (node->prev) node->prev->next = node->next;
+    else m_head = node->next;
+    if (node->next) node->next->prev = node->prev;
+    else m_tail = node->prev;
+    node->prev = node->next = nullptr;
+}
+
+void TileCache::pushFront(Node* node) {
+    node->prev = nullptr;
+    node->next = m_head;
+    if (m_head) m_head->prev = node;
+    m_head = node;
+    if (!m_tail) m_tail = node;
+}
+
+void TileCache::evictToBudget() {
+    // 至少保留最新插入的一块，避免单块超预算时缓存抖动为空
+    while (m_bytes > m_budget && m_tail && m_tail != m_head) {
+        Node* victim = m_tail;
+        unlink(victim);
+        m_index.remove(victim->key);
+        release(victim, true);
+    }
+}
+
+void TileCache::release(Node* node, bool evicted) {
+    LevelStats& stats = m_levelStats[node->key.level];
+    stats.bytes -= node->cost;
+    --stats.tiles;
+    m_bytes -= node->cost;
+    if (evicted) {
+        ++stats.evictions;
+        if (m_onEvict) m_onEvict(node->key, node->image);
+    }
+    delete node;
+}
+
+uint qHash(const TileKey& key, uint seed) noexcept {
+    seed = ::qHash(static_cast<quint64>(key.level), seed);
+    seed = ::qHash(static_cast<quint64>(key.x), seed ^ 0x9e3779b9U);
+    seed = ::qHash(static_cast<quint64>(key.y), seed ^ 0x85ebca6bU);
+    seed = ::qHash(static_cast<quint64>(key.slide), seed ^ 0xc2b2ae35U);
+    return seed;
+}
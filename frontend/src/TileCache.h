@@ -0,0 +1,85 @@
+#pragma once
+#include <QImage>
+#include <QHash>
+#include <QVector>
+
+#include <functional>
+
+// level 坐标系下的 tile 左上角；slide 区分同一进程内先后打开的切片
+struct TileKey {
+    int level{0};
+    qint64 x{0};
+    qint64 y{0};
+    int slide{0};
+    bool operator==(const TileKey& other) const noexcept {
+        return level == other.level && x == other.x && y == other.y && slide == other.slide;
+    }
+};
+
+uint qHash(const TileKey& key, uint seed = 0) noexcept;
+
+// 按字节预算淘汰的 LRU tile 缓存：哈希索引 + 侵入式双向链表，命中/插入/淘汰均为 O(1)。
+// 非线程安全，由调用方保证单线程访问。
+class TileCache {
+public:
+    struct LevelStats {
+        quint64 hits{0};
+        quint64 misses{0};
+        quint64 insertions{0};
+        quint64 evictions{0};
+        qint64 bytes{0};
+        int tiles{0};
+    };
+    using EvictionCallback = std::function<void(const TileKey& key, const QImage& image)>;
+
+    explicit TileCache(qint64 byteBudget = 256ll * 1024 * 1024);
+    ~TileCache();
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // 命中时移到队首并计入统计；未命中返回空 QImage
+    QImage find(const TileKey& key);
+    // 只查询，不影响 LRU 顺序与统计
+    bool contains(const TileKey& key) const { return m_index.contains(key); }
+    QImage peek(const TileKey& key) const;
+
+    void insert(const TileKey& key, const QImage& image);
+    bool remove(const TileKey& key);
+    // 删除所有满足条件的 tile，不触发淘汰回调；返回删除数量
+    int removeIf(const std::function<bool(const TileKey& key)>& pred);
+    // 清空不触发淘汰回调
+    void clear();
+
+    void setByteBudget(qint64 bytes);
+    qint64 byteBudget() const { return m_budget; }
+    qint64 bytes() const { return m_bytes; }
+    int count() const { return m_index.size(); }
+
+    void setEvictionCallback(EvictionCallback callback) { m_onEvict = std::move(callback); }
+
+    LevelStats levelStats(int level) const { return m_levelStats.value(level); }
+    QVector<int> statLevels() const { return m_levelStats.keys().toVector(); }
+    void resetStats();
+
+private:
+    struct Node {
+        TileKey key;
+        QImage image;
+        qint64 cost{0};
+        Node* prev{nullptr};
+        Node* next{nullptr};
+    };
+
+    void unlink(Node* node);
+    void pushFront(Node* node);
+    void evictToBudget();
+    void release(Node* node, bool evicted);
+
+    QHash<TileKey, Node*> m_index;
+    Node* m_head{nullptr};
+    Node* m_tail{nullptr};
+    qint64 m_budget{0};
+    qint64 m_bytes{0};
+    QHash<int, LevelStats> m_levelStats;
+    EvictionCallback m_onEvict;
+};
@@ -0,0 +1,108 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+
+void TileScheduler::setBatchSize(int tiles) {
+    m_batchSize = std::max(1, tiles);
+}
+
+void TileScheduler::setMaxInFlight(int tiles) {
+    m_maxInFlight = std::max(1, tiles);
+    pump();
+}
+
+void TileScheduler::setPrefetchBudget(int tiles) {
+    m_prefetchBudget = std::max(0, tiles);
+    pump();
+}
+
+void TileScheduler::push(const Queued& queued) {
+    m_heap.push_back(HeapItem{queued.request.priority, queued.stamp, queued.request.key});
+    std::push_heap(m_heap.begin(), m_heap.end(), later);
+}
+
+void TileScheduler::rebuildHeap() {
+    m_heap.clear();
+    m_heap.reserve(m_queue.size());
+    for (const auto& queued : std::as_const(m_queue)) {
+        m_heap.push_back(HeapItem{queued.request.priority, queued.stamp, queued.request.key});
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), later);
+}
+
+void TileScheduler::enqueue(const TileKey& key, const RegionRequest& region, double priority) {
+    if (priority < 0.0) return;
+    auto it = m_queue.find(key);
+    if (it != m_queue.end()) {
+        if (it->request.priority == priority) return;
+        it->request.priority = priority;
+        it->stamp = ++m_nextStamp;
+        push(*it);
+    } else {
+        push(*m_queue.insert(key, Queued{Request{key, region, priority}, ++m_nextStamp}));
+    }
+    // 过期项太多时整体重建，堆的大小保持在队列的常数倍
+    if (m_heap.size() > 2 * static_cast<size_t>(m_queue.size()) + 64) {
+        rebuildHeap();
+    }
+}
+
+void TileScheduler::reprioritize(const PriorityFunction& priorityOf) {
+    for (auto it = m_queue.begin(); it != m_queue.end();) {
+        const double priority = priorityOf(it.key());
+        if (priority < 0.0) {
+            it = m_queue.erase(it);
+        } else {
+            it->request.priority = priority;
+            ++it;
+        }
+    }
+    // 优先级整体变了，直接 O(n) 建堆
+    rebuildHeap();
+}
+
+void TileScheduler::finished(const TileKey& key) {
+    auto it = m_inFlight.find(key);
+    if (it == m_inFlight.end()) return;
+    if (it.value()) --m_prefetchInFlight;
+    m_inFlight.erase(it);
+    pump();
+}
+
+void TileScheduler::pump() {
+    if (!m_dispatcher || m_queue.isEmpty()) return;
+    int slots = m_maxInFlight - m_inFlight.size();
+    if (slots <= 0) return;
+
+    QVector<Request> selected;
+    while (slots > 0 && !m_heap.empty()) {
+        const HeapItem top = m_heap.front();
+        auto it = m_queue.find(top.key);
+        if (it == m_queue.end() || it->stamp != top.stamp) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), later);
+            m_heap.pop_back();
+            continue;   // 已派发、已丢弃或优先级已更新
+        }
+        const bool prefetch = isPrefetch(it->request);
+        if (prefetch && m_prefetchInFlight >= m_prefetchBudget) {
+            break;   // 其后全是预取
+        }
+        std::pop_heap(m_heap.begin(), m_heap.end(), later);
+        m_heap.pop_back();
+        selected.push_back(it->request);
+        m_queue.erase(it);
+        m_inFlight.insert(top.key, prefetch);
+        if (prefetch) ++m_prefetchInFlight;
+        --slots;
+    }
+    for (int start = 0; start < selected.size(); start += m_batchSize) {
+        m_dispatcher(selected.mid(start, std::min<int>(m_batchSize, selected.size() - start)));
+    }
+}
+
+void TileScheduler::clear() {
+    m_queue.clear();
+    m_heap.clear();
+    m_inFlight.clear();
+    m_prefetchInFlight = 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "TileCache.h"
+#include "TileSource.h"
+
+#include <QHash>
+#include <QVector>
+
+#include <functional>
+#include <vector>
+
+// 视图侧的 tile 请求调度：请求先进入优先级队列，只有排在最前的才发往网络，
+// 同时在途的 tile 数受限。视口变化时重新计算优先级，离开视野的请求在发出前被丢弃。
+// 仅在 GUI 线程使用。
+class TileScheduler {
+public:
+    struct Request {
+        TileKey key;
+        RegionRequest region;
+        double priority{0.0};
+    };
+    // 一次派发一批（同一个 /regions 请求）
+    using Dispatcher = std::function<void(const QVector<Request>& batch)>;
+    // 数值越小越优先；返回负数表示该 tile 已不需要。
+    // 优先级分段：可见 < 边缘 < 预取，段内按距离排序
+    static constexpr double kVisibleBand = 0.0;
+    static constexpr double kMarginBand = 1e6;
+    static constexpr double kPrefetchBand = 2e6;
+    using PriorityFunction = std::function<double(const TileKey& key)>;
+
+    void setDispatcher(Dispatcher dispatcher) { m_dispatcher = std::move(dispatcher); }
+    void setBatchSize(int tiles);
+    void setMaxInFlight(int tiles);
+    // 预取请求单独限额，保证预取只占用一部分带宽
+    void setPrefetchBudget(int tiles);
+
+    // 已在队列中则只更新优先级
+    void enqueue(const TileKey& key, const RegionRequest& region, double priority);
+    void reprioritize(const PriorityFunction& priorityOf);
+    bool isQueued(const TileKey& key) const { return m_queue.contains(key); }
+
+    // 派发出去的 tile 完成（成功、失败或取消）后调用，腾出名额继续派发
+    void finished(const TileKey& key);
+    void pump();
+    void clear();
+
+    int queuedCount() const { return m_queue.size(); }
+    int inFlight() const { return m_inFlight.size(); }
+
+private:
+    static bool isPrefetch(const Request& request) { return request.priority >= kPrefetchBand; }
+
+    // 按优先级的最小堆，惰性删除：更新优先级时压入新项，旧项的 stamp 与队列中不符，出堆时跳过
+    struct HeapItem {
+        double priority;
+        quint64 stamp;
+        TileKey key;
+    };
+    struct Queued {
+        Request request;
+        quint64 stamp{0};
+    };
+    // std::*_heap 为最大堆，反过来比较得到最小堆
+    static bool later(const HeapItem& a, const HeapItem& b) { return a.priority > b.priority; }
+    void push(const Queued& queued);
+    void rebuildHeap();
+
+    QHash<TileKey, Queued> m_queue;
+    std::vector<HeapItem> m_heap;
+    quint64 m_nextStamp{0};
+    QHash<TileKey, bool> m_inFlight;   // key -> 是否为预取
+    Dispatcher m_dispatcher;
+    int m_batchSize{12};
+    int m_maxInFlight{48};
+    int m_prefetchBudget{12};
+    int m_prefetchInFlight{0};
+};
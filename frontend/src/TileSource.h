@@ -0,0 +1,131 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <QImage>
+#include <QVector>
+#include <QSize>
+#include <QFuture>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+
+#include <functional>
+#include <memory>
+
+// 瓦片传输格式，对应后端 /region 的 format 参数
+enum class TileFormat { Png = 0, Jpeg, WebP, Raw };
+// 导航（平移缩放）追求速度，识别追求无损，两者分别配置格式
+enum class TileUsage { Navigation, Analysis };
+
+struct TransferStats {
+    quint64 tiles{0};
+    quint64 bytes{0};
+    double decodeMs{0.0};
+    double bytesPerTile() const { return tiles ? static_cast<double>(bytes) / tiles : 0.0; }
+    double decodeMsPerTile() const { return tiles ? decodeMs / tiles : 0.0; }
+};
+
+// 坐标为该 level 的像素坐标
+struct RegionRequest {
+    int level{0};
+    qint64 x{0};
+    qint64 y{0};
+    int w{0};
+    int h{0};
+};
+
+struct SlideInfo {
+    int slideId{-1};              // 后端 slide id；本地源为 -1
+    int levelCount{0};
+    QVector<QSize> levelDims;
+    QVector<double> downsamples;
+    QString version;              // 后端报告的文件大小与修改时间；本地源为空
+};
+
+// 后端传来的已编码 tile（解码前的原始字节），磁盘缓存按此原样保存
+struct TilePayload {
+    QByteArray bytes;
+    QByteArray contentType;
+    int width{0};
+    int height{0};
+};
+
+// 协作式取消：复制后共享同一状态。排队中的读取检查 isCanceled()，
+// 已发出的请求通过 onCancel 登记中断动作（如 abort 网络请求），cancel() 时立即执行。
+class CancelToken {
+public:
+    CancelToken() : m_state(std::make_shared<State>()) {}
+
+    void cancel() const {
+        QHash<int, std::function<void()>> callbacks;
+        {
+            QMutexLocker locker(&m_state->mutex);
+            if (m_state->canceled) return;
+            m_state->canceled = true;
+            callbacks.swap(m_state->callbacks);
+        }
+        for (const auto& fn : std::as_const(callbacks)) {
+            fn();
+        }
+    }
+
+    bool isCanceled() const {
+        QMutexLocker locker(&m_state->mutex);
+        return m_state->canceled;
+    }
+
+    // 已取消时立即执行并返回 0；否则返回登记号，请求结束后应 removeCallback 释放
+    int onCancel(std::function<void()> fn) const {
+        {
+            QMutexLocker locker(&m_state->mutex);
+            if (!m_state->canceled) {
+                const int id = ++m_state->nextId;
+                m_state->callbacks.insert(id, std::move(fn));
+                return id;
+            }
+        }
+        fn();
+        return 0;
+    }
+
+    void removeCallback(int id) const {
+        if (id <= 0) return;
+        QMutexLocker locker(&m_state->mutex);
+        m_state->callbacks.remove(id);
+    }
+
+private:
+    struct State {
+        QMutex mutex;
+        bool canceled{false};
+        int nextId{0};
+        QHash<int, std::function<void()>> callbacks;
+    };
+    std::shared_ptr<State> m_state;
+};
+
+// 像素来源的抽象：HTTP 后端或进程内 OpenSlide。
+// 所有读取都是非阻塞的，失败或被取消时 future 的结果为空 QImage。
+class TileSource {
+public:
+    virtual ~TileSource() = default;
+
+    virtual bool open(const QString& path, SlideInfo* info) = 0;
+    virtual void close() = 0;
+
+    virtual QFuture<QImage> readRegionAsync(const RegionRequest& region, TileUsage usage,
+                                            const CancelToken& cancel = CancelToken()) = 0;
+    // 默认逐个读取；支持批量的实现可合并为一次请求
+    virtual QVector<QFuture<QImage>> readRegionsAsync(const QVector<RegionRequest>& regions, TileUsage usage,
+                                                      const CancelToken& cancel = CancelToken()) {
+        QVector<QFuture<QImage>> futures;
+        futures.reserve(regions.size());
+        for (const auto& r : regions) {
+            futures.push_back(readRegionAsync(r, usage, cancel));
+        }
+        return futures;
+    }
+
+    // 是否需要后端参与（识别时据此决定坐标由谁换算到 level0）
+    virtual bool isRemote() const = 0;
+};
@@ -0,0 +1,233 @@
+#include "TileStore.h"
+
+#include <QMutexLocker>
+#include <QPromise>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace {
+// 视图原有 192 个、区域读取原有 256 个 512px ARGB tile（各 1MB），合计 448MB
+constexpr qint64 kDefaultBudget = 448ll * 1024 * 1024;
+}
+
+TileStore& TileStore::instance() {
+    static TileStore store;
+    return store;
+}
+
+TileStore::TileStore() {
+    setByteBudget(kDefaultBudget);
+}
+
+int TileStore::nextSlideToken() {
+    static std::atomic<int> counter{0};
+    return ++counter;
+}
+
+TileStore::Shard& TileStore::shardFor(const TileKey& key) {
+    return m_shards[qHash(key) % kShardCount];
+}
+
+const TileStore::Shard& TileStore::shardFor(const TileKey& key) const {
+    return m_shards[qHash(key) % kShardCount];
+}
+
+QImage TileStore::find(const TileKey& key) {
+    Shard& shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    return shard.cache.find(key);
+}
+
+QImage TileStore::peek(const TileKey& key) const {
+    const Shard& shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    return shard.cache.peek(key);
+}
+
+bool TileStore::contains(const TileKey& key) const {
+    const Shard& shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    return shard.cache.contains(key);
+}
+
+bool TileStore::isInFlight(const TileKey& key) const {
+    const Shard& shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    return shard.inFlight.contains(key);
+}
+
+void TileStore::insert(const TileKey& key, const QImage& image) {
+    if (image.isNull()) return;
+    Shard& shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    if (shard.closedSlides.contains(key.slide)) return;
+    shard.cache.insert(key, image);
+}
+
+void TileStore::complete(const TileKey& key, const std::shared_ptr<Flight>& flight, const QImage& image) {
+    Shard& shard = shardFor(key);
+    QMutexLocker locker(&shard.mutex);
+    // 被放弃后可能已有新的读取登记在同一 key 上，只移除自己
+    auto it = shard.inFlight.find(key);
+    if (it != shard.inFlight.end() && it.value() == flight) {
+        shard.inFlight.erase(it);
+    }
+    if (!image.isNull() && !shard.closedSlides.contains(key.slide)) {
+        shard.cache.insert(key, image);
+    }
+}
+
+void TileStore::release(const TileKey& key, const std::shared_ptr<Flight>& flight) {
+    bool abort = false;
+    {
+        Shard& shard = shardFor(key);
+        QMutexLocker locker(&shard.mutex);
+        if (--flight->interest > 0) return;
+        QMutexLocker batchLocker(&flight->batch->mutex);
+        if (--flight->batch->live == 0 && !flight->batch->canceled) {
+            flight->batch->canceled = true;
+            abort = true;
+        }
+    }
+    // 取消回调会中止网络请求，放在锁外执行
+    if (abort) flight->batch->cancel.cancel();
+}
+
+QVector<QFuture<QImage>> TileStore::fetch(const QVector<TileKey>& keys, const BatchLoader& loader,
+                                          const CancelToken& cancel) {
+    QVector<QFuture<QImage>> futures(keys.size());
+    QVector<std::shared_ptr<Flight>> flights(keys.size());
+    QVector<int> missing;
+    QVector<std::shared_ptr<QPromise<QImage>>> claims;
+    auto batch = std::make_shared<Batch>();
+
+    // 先在锁内登记（或加入）在途读取，保证并发调用方共享同一个请求
+    for (int i = 0; i < keys.size(); ++i) {
+        const TileKey& key = keys[i];
+        Shard& shard = shardFor(key);
+        QMutexLocker locker(&shard.mutex);
+        if (shard.closedSlides.contains(key.slide)) {
+            futures[i] = QtFuture::makeReadyFuture(QImage());
+            continue;
+        }
+        const QImage cached = shard.cache.find(key);
+        if (!cached.isNull()) {
+            futures[i] = QtFuture::makeReadyFuture(cached);
+            continue;
+        }
+        auto it = shard.inFlight.constFind(key);
+        if (it != shard.inFlight.constEnd()) {
+            const std::shared_ptr<Flight>& flight = it.value();
+            QMutexLocker batchLocker(&flight->batch->mutex);
+            // 已被中止的读取只会以空图结束，不再加入，改为重新读取
+            if (!flight->batch->canceled) {
+                if (flight->interest++ == 0) ++flight->batch->live;
+                flights[i] = flight;
+                continue;
+            }
+        }
+        auto promise = std::make_shared<QPromise<QImage>>();
+        promise->start();
+        auto flight = std::make_shared<Flight>();
+        flight->result = promise->future();
+        flight->batch = batch;
+        flight->interest = 1;
+        ++batch->live;
+        shard.inFlight.insert(key, flight);
+        flights[i] = flight;
+        missing.push_back(i);
+        claims.push_back(promise);
+    }
+
+    // 每个调用方一个转发 future：共享结果与本方取消，谁先到用谁
+    for (int i = 0; i < keys.size(); ++i) {
+        const std::shared_ptr<Flight> flight = flights[i];
+        if (!flight) continue;
+        struct Waiter {
+            QPromise<QImage> promise;
+            std::atomic<bool> done{false};
+            int cancelId{0};
+        };
+        auto waiter = std::make_shared<Waiter>();
+        waiter->promise.start();
+        futures[i] = waiter->promise.future();
+        const auto deliver = [waiter](const QImage& image) {
+            if (waiter->done.exchange(true)) return false;
+            waiter->promise.addResult(image);
+            waiter->promise.finish();
+            return true;
+        };
+        flight->result
+            .then(QtFuture::Launch::Sync, [deliver, waiter, cancel](const QImage& image) {
+                if (deliver(image)) cancel.removeCallback(waiter->cancelId);
+            })
+            .onCanceled([deliver]() { deliver(QImage()); });
+        const TileKey key = keys[i];
+        waiter->cancelId = cancel.onCancel([this, deliver, key, flight]() {
+            if (deliver(QImage())) release(key, flight);
+        });
+    }
+    if (missing.isEmpty()) return futures;
+
+    const QVector<QFuture<QImage>> loaded = loader ? loader(missing, batch->cancel) : QVector<QFuture<QImage>>();
+    for (int m = 0; m < missing.size(); ++m) {
+        const TileKey key = keys[missing[m]];
+        const std::shared_ptr<Flight> flight = flights[missing[m]];
+        auto promise = claims[m];
+        auto settle = [this, key, flight, promise](const QImage& image) {
+            complete(key, flight, image);
+            promise->addResult(image);
+            promise->finish();
+        };
+        if (m >= loaded.size()) {
+            settle(QImage());
+            continue;
+        }
+        // 续体在读取完成的线程上同步执行
+        QFuture<QImage> source = loaded[m];
+        source
+            .then(QtFuture::Launch::Sync, [settle](const QImage& image) {
+                settle(image);
+                return image;
+            })
+            .onCanceled([settle]() {
+                settle(QImage());
+                return QImage();
+            });
+    }
+    return futures;
+}
+
+void TileStore::removeSlide(int slide) {
+    for (auto& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.closedSlides.insert(slide);
+        shard.cache.removeIf([slide](const TileKey& key) { return key.slide == slide; });
+        for (auto it = shard.inFlight.begin(); it != shard.inFlight.end();) {
+            if (it.key().slide == slide) {
+                it = shard.inFlight.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void TileStore::setByteBudget(qint64 bytes) {
+    const qint64 perShard = std::max<qint64>(1, bytes / kShardCount);
+    for (auto& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.cache.setByteBudget(perShard);
+    }
+}
+
+qint64 TileStore::bytes() const {
+    qint64 total = 0;
+    for (const auto& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        total += shard.cache.bytes();
+    }
+    return total;
+}
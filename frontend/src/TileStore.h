@@ -0,0 +1,77 @@
+#pragma once
+#include "TileCache.h"
+#include "TileSource.h"
+
+#include <QFuture>
+#include <QMutex>
+#include <QSet>
+#include <QVector>
+
+#include <array>
+#include <functional>
+#include <memory>
+
+// 进程内唯一的 tile 存储：视图渲染、区域读取、迷你图、识别都从这里读写。
+// 按 key 哈希分片，每片一把锁；同一 tile 的并发请求只会真正读取一次（single-flight）。
+// 每个调用方拿到自己的 future：调用方取消只让自己的 future 以空图结束，
+// 底层读取要等所有关心它的调用方都取消后才中止。
+class TileStore {
+public:
+    // 为 missing 中的下标发起读取，返回与之一一对应的 future；cancel 由 TileStore 持有，
+    // 在这批 tile 都没有调用方关心时触发
+    using BatchLoader = std::function<QVector<QFuture<QImage>>(const QVector<int>& missing,
+                                                               const CancelToken& cancel)>;
+
+    static TileStore& instance();
+
+    // 命中时更新 LRU；未命中返回空 QImage
+    QImage find(const TileKey& key);
+    QImage peek(const TileKey& key) const;
+    bool contains(const TileKey& key) const;
+    bool isInFlight(const TileKey& key) const;
+    void insert(const TileKey& key, const QImage& image);
+
+    // 已缓存的直接就绪，已在途的共享同一次读取，其余交给 loader 一次性读取。
+    // cancel 只作用于本次调用返回的 future
+    QVector<QFuture<QImage>> fetch(const QVector<TileKey>& keys, const BatchLoader& loader,
+                                   const CancelToken& cancel = CancelToken());
+
+    // 切片关闭时丢弃其全部 tile 与在途登记；之后完成的读取不再进缓存
+    void removeSlide(int slide);
+    void setByteBudget(qint64 bytes);
+    qint64 bytes() const;
+
+    // 每次打开切片分配一个新的 slide 编号
+    static int nextSlideToken();
+
+private:
+    TileStore();
+
+    static constexpr int kShardCount = 16;
+    // 一次 loader 调用发出的读取；live 为仍有调用方关心的 tile 数，降到 0 时中止
+    struct Batch {
+        QMutex mutex;
+        int live{0};
+        bool canceled{false};
+        CancelToken cancel;
+    };
+    // 一个在途 tile；interest 为尚未取消的调用方数，由所在分片的锁保护
+    struct Flight {
+        QFuture<QImage> result;
+        std::shared_ptr<Batch> batch;
+        int interest{0};
+    };
+    struct Shard {
+        mutable QMutex mutex;
+        TileCache cache;
+        QHash<TileKey, std::shared_ptr<Flight>> inFlight;
+        QSet<int> closedSlides;     // 已关闭的 slide 编号（编号不复用，每片一份）
+    };
+
+    Shard& shardFor(const TileKey& key);
+    const Shard& shardFor(const TileKey& key) const;
+    void complete(const TileKey& key, const std::shared_ptr<Flight>& flight, const QImage& image);
+    void release(const TileKey& key, const std::shared_ptr<Flight>& flight);
+
+    std::array<Shard, kShardCount> m_shards;
+};
@@ -1,101 +1,85 @@
 #include "WSIHandler.h"
+#include "HttpTileSource.h"
+#include "OpenSlideTileSource.h"
+#include "TileStore.h"
+#include "DiskTileCache.h"
 
-#include <QNetworkAccessManager>
-#include <QNetworkRequest>
-#include <QNetworkReply>
-#include <QUrlQuery>
-#include <QEventLoop>
-#include <QTimer>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
+#include <QFileInfo>
 #include <QPainter>
 #include <QHashFunctions>
 #include <QtGlobal>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <memory>
 
-WSIHandler::WSIHandler(const QUrl& backendBase): m_base(backendBase) {}
-WSIHandler::~WSIHandler() = default;
+namespace {
 
-bool WSIHandler::open(const QString& path){
-    QUrl url(m_base);
-    url.setPath("/open_wsi");
-    QUrlQuery q; q.addQueryItem("path", path); url.setQuery(q);
-
-    QNetworkAccessManager mgr;
-    QNetworkRequest req(url);
-    QEventLoop loop;
-    QTimer timer; timer.setSingleShot(true);
-    QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    QNetworkReply* reply = mgr.post(req, QByteArray());
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    timer.start(15000);
-    loop.exec();
-
-    if(!timer.isActive() || reply->error()!=QNetworkReply::NoError){
-        reply->deleteLater();
-        return false;
-    }
-    const auto data = reply->readAll();
-    reply->deleteLater();
+// 转成光栅引擎原生格式（不透明 RGB32，带透明度的预乘 ARGB32），之后每帧绘制都无需转换
+QImage toRenderFormat(const QImage& image) {
+    if (image.isNull()) return image;
+    const QImage::Format target = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                          : QImage::Format_RGB32;
+    return image.format() == target ? image : image.convertToFormat(target);
+}
 
-    const auto doc = QJsonDocument::fromJson(data);
-    if(!doc.isObject()) return false;
-    const auto obj = doc.object();
+} // namespace
 
-    m_slideId = obj.value("id").toInt(-1);
-    m_levelCount = obj.value("level_count").toInt(0);
+WSIHandler::WSIHandler(const QUrl& backendBase)
+    : m_httpSource(std::make_unique<HttpTileSource>(backendBase)) {
+    // 启动时就开始在后台建立磁盘缓存索引，打开第一张切片时多半已经建好
+    DiskTileCache::instance();
+}
+
+WSIHandler::~WSIHandler() {
+    resetCache();
+}
+
+bool WSIHandler::open(const QString& path){
+    if (m_source) {
+        m_source->close();
+    }
+    m_source = nullptr;
+    m_nativeSource.reset();
+    m_slideId = -1;
+    m_levelCount = 0;
     m_levelDims.clear();
     m_downsamples.clear();
+    m_diskSlide.clear();
+    resetCache();
 
-    const auto dimsObj = obj.value("level_dimensions");
-    if (dimsObj.isArray()) {
-        const auto dims = dimsObj.toArray();
-        for (const auto& it : dims) {
-            if (it.isObject()) {
-                const auto o = it.toObject();
-                m_levelDims.push_back(QSize(o.value("w").toInt(), o.value("h").toInt()));
-            } else if (it.isArray()) {
-                const auto pair = it.toArray();
-                if (pair.size() == 2) {
-                    m_levelDims.push_back(QSize(pair.at(0).toInt(), pair.at(1).toInt()));
-                }
-            }
+    SlideInfo info;
+    if (m_preferNative && OpenSlideTileSource::isAvailable() && QFileInfo::exists(path)) {
+        auto native = std::make_unique<OpenSlideTileSource>();
+        if (native->open(path, &info)) {
+            m_nativeSource = std::move(native);
+            m_source = m_nativeSource.get();
         }
     }
-    const auto downsamples = obj.value("level_downsamples").toArray();
-    for (const auto& it : downsamples) {
-        m_downsamples.push_back(it.toDouble(1.0));
-    }
-    if (m_downsamples.isEmpty() && !m_levelDims.isEmpty()) {
-        m_downsamples.reserve(m_levelDims.size());
-        for (int i = 0; i < m_levelDims.size(); ++i) {
-            m_downsamples.push_back(i == 0 ? 1.0 : std::pow(2.0, i));
+    if (!m_source) {
+        if (!m_httpSource->open(path, &info)) {
+            return false;
         }
+        m_source = m_httpSource.get();
+        m_diskSlide = DiskTileCache::slideIdentity(path, m_httpSource->backendBase().toString(), info.version);
     }
 
-    if (m_levelCount == 0) {
-        m_levelCount = std::min(m_levelDims.size(), m_downsamples.size());
-    } else {
-        m_levelCount = std::min<int>(m_levelCount, std::min(m_levelDims.size(), m_downsamples.size()));
-    }
-
-    resetCache();
-    const bool ok = (m_slideId > 0) && (m_levelCount > 0) && !m_levelDims.isEmpty() && !m_downsamples.isEmpty();
-    if (!ok) {
-        m_slideId = -1;
-        m_levelCount = 0;
-        m_levelDims.clear();
-        m_downsamples.clear();
-    }
-    return ok;
+    m_slideToken = TileStore::nextSlideToken();
+    m_slideId = info.slideId;
+    m_levelCount = info.levelCount;
+    m_levelDims = info.levelDims;
+    m_downsamples = info.downsamples;
+    return true;
 }
 
+bool WSIHandler::isOpen() const { return m_source && m_levelCount > 0; }
 
-bool WSIHandler::isOpen() const { return m_slideId > 0; }
+bool WSIHandler::isNativeSource() const {
+    return m_source && !m_source->isRemote();
+}
 
 QSize WSIHandler::levelSize(int level) const {
     if(level < 0 || level >= m_levelDims.size()) return {};
@@ -103,135 +87,163 @@ QSize WSIHandler::levelSize(int level) const {
 }
 
 void WSIHandler::resetCache() {
-    m_tileCache.clear();
-    m_lru.clear();
-}
-
-void WSIHandler::touchTile(const TileKey& key) {
-    m_lru.removeAll(key);
-    m_lru.prepend(key);
-    while (m_lru.size() > m_cacheCapacity) {
-        const TileKey last = m_lru.takeLast();
-        m_tileCache.remove(last);
+    if (m_slideToken > 0) {
+        TileStore::instance().removeSlide(m_slideToken);
     }
+    m_slideToken = 0;
 }
 
-QImage WSIHandler::requestRegion(int level, qint64 x, qint64 y, int w, int h){
-    QUrl url(m_base);
-    url.setPath("/region");
-    QUrlQuery q;
-    q.addQueryItem("id", QString::number(m_slideId));
-    q.addQueryItem("level", QString::number(level));
-    q.addQueryItem("x", QString::number(x));
-    q.addQueryItem("y", QString::number(y));
-    q.addQueryItem("w", QString::number(w));
-    q.addQueryItem("h", QString::number(h));
-    url.setQuery(q);
-
-    QNetworkAccessManager mgr;
-    QNetworkRequest req(url);
-    QEventLoop loop;
-    QTimer timer; timer.setSingleShot(true);
-    QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    QNetworkReply* reply = mgr.get(req);
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    timer.start(15000);
-    loop.exec();
-
-    QImage out;
-    if(timer.isActive() && reply->error()==QNetworkReply::NoError){
-        const auto bytes = reply->readAll();
-        out.loadFromData(bytes, "PNG");
+QFuture<QImage> WSIHandler::requestRegionAsync(int level, qint64 x, qint64 y, int w, int h, TileUsage usage) const {
+    if (!m_source) {
+        return QtFuture::makeReadyFuture(QImage());
     }
-    reply->deleteLater();
-    return out;
+    return m_source->readRegionAsync(RegionRequest{level, x, y, w, h}, usage);
 }
 
-QImage WSIHandler::fetchTile(int level, qint64 x, qint64 y, int w, int h) {
-    const TileKey key{level, x, y};
-    auto it = m_tileCache.find(key);
-    if (it != m_tileCache.end()) {
-        touchTile(key);
-        return it.value();
+QVector<QFuture<QImage>> WSIHandler::requestRegionsAsync(const QVector<RegionRequest>& regions, TileUsage usage,
+                                                         const CancelToken& cancel) const {
+    if (regions.isEmpty()) {
+        return {};
     }
-    QImage tile = requestRegion(level, x, y, w, h);
-    if (!tile.isNull()) {
-        m_tileCache.insert(key, tile);
-        touchTile(key);
+    if (!m_source) {
+        QVector<QFuture<QImage>> futures;
+        for (int i = 0; i < regions.size(); ++i) {
+            futures.push_back(QtFuture::makeReadyFuture(QImage()));
+        }
+        return futures;
     }
-    return tile;
+    return m_source->readRegionsAsync(regions, usage, cancel);
 }
 
-QImage WSIHandler::readRegionAtCurrentScale(qint64 x0, qint64 y0, int wView, int hView, int level, double viewScale){
-    if (!isOpen() || level < 0 || level >= m_levelCount) return QImage();
-    if (wView <= 0 || hView <= 0 || viewScale <= 0.0) return QImage();
-
-    const double downsample = (level >= 0 && level < m_downsamples.size() && m_downsamples[level] > 0.0)
-                                  ? m_downsamples[level]
-                                  : std::pow(2.0, level);
-    const QSize levelSize = m_levelDims.value(level);
-    if (levelSize.width() <= 0 || levelSize.height() <= 0) return QImage();
-
-    const double worldWidth = static_cast<double>(wView) / viewScale;
-    const double worldHeight = static_cast<double>(hView) / viewScale;
-    if (worldWidth <= 0.0 || worldHeight <= 0.0) return QImage();
-
-    const double levelX = static_cast<double>(x0) / downsample;
-    const double levelY = static_cast<double>(y0) / downsample;
-    const double levelRight = levelX + worldWidth / downsample;
-    const double levelBottom = levelY + worldHeight / downsample;
-
-    qint64 pixelStartX = std::max<qint64>(0, static_cast<qint64>(std::floor(levelX)));
-    qint64 pixelStartY = std::max<qint64>(0, static_cast<qint64>(std::floor(levelY)));
-    qint64 pixelEndX = std::min<qint64>(levelSize.width(), static_cast<qint64>(std::ceil(levelRight)));
-    qint64 pixelEndY = std::min<qint64>(levelSize.height(), static_cast<qint64>(std::ceil(levelBottom)));
-
-    if (pixelEndX <= pixelStartX || pixelEndY <= pixelStartY) return QImage();
-
-    constexpr qint64 tileSize = 512;
-    qint64 tileXStart = (pixelStartX / tileSize) * tileSize;
-    qint64 tileYStart = (pixelStartY / tileSize) * tileSize;
-    tileXStart = std::max<qint64>(0, tileXStart);
-    tileYStart = std::max<qint64>(0, tileYStart);
-
-    qint64 tileXEnd = ((pixelEndX + tileSize - 1) / tileSize) * tileSize;
-    qint64 tileYEnd = ((pixelEndY + tileSize - 1) / tileSize) * tileSize;
-    tileXEnd = std::min<qint64>(levelSize.width(), tileXEnd);
-    tileYEnd = std::min<qint64>(levelSize.height(), tileYEnd);
-
-    if (tileXEnd <= tileXStart || tileYEnd <= tileYStart) return QImage();
+void WSIHandler::setTileFormat(TileUsage usage, TileFormat format, int quality) {
+    m_httpSource->setTileFormat(usage, format, quality);
+}
 
-    const int canvasWidth = static_cast<int>(tileXEnd - tileXStart);
-    const int canvasHeight = static_cast<int>(tileYEnd - tileYStart);
-    if (canvasWidth <= 0 || canvasHeight <= 0) return QImage();
+WSIHandler::TileFormat WSIHandler::tileFormat(TileUsage usage) const {
+    return m_httpSource->tileFormat(usage);
+}
 
-    QImage canvas(canvasWidth, canvasHeight, QImage::Format_RGB32);
-    canvas.fill(Qt::gray);
+WSIHandler::TransferStats WSIHandler::transferStats(TileFormat format) const {
+    return m_httpSource->transferStats(format);
+}
 
-    QPainter painter(&canvas);
-    painter.setCompositionMode(QPainter::CompositionMode_Source);
+void WSIHandler::resetTransferStats() {
+    m_httpSource->resetTransferStats();
+}
 
+QFuture<QImage> WSIHandler::readLevelRegionAsync(int level, const QRect& levelRect, TileUsage usage,
+                                                 const CancelToken& cancel) const {
+    if (!isOpen() || level < 0 || level >= m_levelCount) return QtFuture::makeReadyFuture(QImage());
+    const QSize levelSize = m_levelDims.value(level);
+    const QRect rect = levelRect.intersected(QRect(QPoint(0, 0), levelSize));
+    if (rect.isEmpty()) return QtFuture::makeReadyFuture(QImage());
+
+    const qint64 pixelStartX = rect.x();
+    const qint64 pixelStartY = rect.y();
+    const qint64 pixelEndX = static_cast<qint64>(rect.x()) + rect.width();
+    const qint64 pixelEndY = static_cast<qint64>(rect.y()) + rect.height();
+
+    constexpr qint64 tileSize = kTileSize;
+    const qint64 tileXStart = (pixelStartX / tileSize) * tileSize;
+    const qint64 tileYStart = (pixelStartY / tileSize) * tileSize;
+    const qint64 tileXEnd = std::min<qint64>(levelSize.width(), ((pixelEndX + tileSize - 1) / tileSize) * tileSize);
+    const qint64 tileYEnd = std::min<qint64>(levelSize.height(), ((pixelEndY + tileSize - 1) / tileSize) * tileSize);
+    if (tileXEnd <= tileXStart || tileYEnd <= tileYStart) return QtFuture::makeReadyFuture(QImage());
+
+    QVector<RegionRequest> regions;
     for (qint64 ty = tileYStart; ty < tileYEnd; ty += tileSize) {
         const int tileH = static_cast<int>(std::min<qint64>(tileSize, levelSize.height() - ty));
-        if (tileH <= 0) continue;
         for (qint64 tx = tileXStart; tx < tileXEnd; tx += tileSize) {
             const int tileW = static_cast<int>(std::min<qint64>(tileSize, levelSize.width() - tx));
-            if (tileW <= 0) continue;
-            QImage tile = fetchTile(level, tx, ty, tileW, tileH);
-            if (tile.isNull()) continue;
-            const QRectF dest(QPointF(tx - tileXStart, ty - tileYStart), QSizeF(tile.width(), tile.height()));
-            painter.drawImage(dest, tile);
+            regions.push_back({level, tx, ty, tileW, tileH});
         }
     }
-    painter.end();
+    // 导航用途与视图共享同一份 tile；已在途的不会重复请求
+    const QVector<QFuture<QImage>> futures = fetchTilesAsync(regions, usage, cancel);
+
+    return QtFuture::whenAll(futures.begin(), futures.end())
+        .then(QThreadPool::globalInstance(), [regions, rect](const QList<QFuture<QImage>>& tiles) {
+            QImage canvas(rect.size(), QImage::Format_RGB32);
+            canvas.fill(Qt::gray);
+            QPainter painter(&canvas);
+            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+            for (int i = 0; i < regions.size(); ++i) {
+                const QImage tile = tiles[i].result();
+                // 缺块的拼图会被当作真实像素使用（识别会据此覆盖已有结果），宁可整体失败
+                if (tile.isNull()) return QImage();
+                painter.drawImage(QPointF(regions[i].x - rect.x(), regions[i].y - rect.y()), tile);
+            }
+            painter.end();
+            return canvas;
+        });
+}
+
+bool WSIHandler::sharesNavigationTiles(TileUsage usage) const {
+    return usage == TileUsage::Navigation || m_source != m_httpSource.get();
+}
+
+QVector<QFuture<QImage>> WSIHandler::fetchTilesAsync(const QVector<RegionRequest>& regions, TileUsage usage,
+                                                     const CancelToken& cancel) const {
+    if (!sharesNavigationTiles(usage)) {
+        return requestRegionsAsync(regions, usage, cancel);
+    }
+    QVector<TileKey> keys;
+    keys.reserve(regions.size());
+    for (const auto& r : regions) {
+        keys.push_back(tileKey(r.level, r.x, r.y));
+    }
+    const auto loader = [this, &regions, &keys](const QVector<int>& missing, const CancelToken& batchCancel) {
+        QVector<QFuture<QImage>> futures(missing.size());
+        DiskTileCache& disk = DiskTileCache::instance();
+        const QString slide = m_diskSlide;
+
+        // 先查磁盘缓存（索引在内存中，不触发 IO），命中的在线程池中读文件并解码
+        QVector<int> remote;
+        QVector<RegionRequest> subset;
+        QVector<TileKey> subsetKeys;
+        for (int i = 0; i < missing.size(); ++i) {
+            const int index = missing[i];
+            if (disk.contains(slide, keys[index])) {
+                const TileKey key = keys[index];
+                futures[i] = QtConcurrent::run([slide, key]() {
+                    TilePayload payload;
+                    if (!DiskTileCache::instance().load(slide, key, &payload)) return QImage();
+                    return toRenderFormat(HttpTileSource::decodePayload(payload));
+                });
+            } else {
+                remote.push_back(i);
+                subset.push_back(regions[index]);
+                subsetKeys.push_back(keys[index]);
+            }
+        }
+        if (subset.isEmpty()) {
+            return futures;
+        }
 
-    const int cropX = static_cast<int>(pixelStartX - tileXStart);
-    const int cropY = static_cast<int>(pixelStartY - tileYStart);
-    const int cropW = static_cast<int>(pixelEndX - pixelStartX);
-    const int cropH = static_cast<int>(pixelEndY - pixelStartY);
-    if (cropW <= 0 || cropH <= 0) return QImage();
+        // 用批次自己的令牌：只有所有调用方都放弃时才中止读取。
+        // 远程来源把后端传来的编码字节原样落盘（解码线程上、图像交付之后）
+        QVector<QFuture<QImage>> fetched;
+        if (!slide.isEmpty() && m_source == m_httpSource.get()) {
+            fetched = m_httpSource->readRegionsAsync(subset, TileUsage::Navigation, batchCancel,
+                                                     [slide, subsetKeys](int index, const TilePayload& payload) {
+                DiskTileCache::instance().store(slide, subsetKeys[index], payload);
+            });
+        } else {
+            fetched = requestRegionsAsync(subset, TileUsage::Navigation, batchCancel);
+        }
+        for (int j = 0; j < remote.size(); ++j) {
+            // 在解码线程上一次性转成绘制格式再进缓存
+            futures[remote[j]] = fetched[j].then(QtFuture::Launch::Sync, [](const QImage& decoded) {
+                return toRenderFormat(decoded);
+            });
+        }
+        return futures;
+    };
+    return TileStore::instance().fetch(keys, loader, cancel);
+}
 
-    return canvas.copy(cropX, cropY, cropW, cropH);
+QImage WSIHandler::cachedTile(int level, qint64 x, qint64 y) const {
+    return TileStore::instance().find(tileKey(level, x, y));
 }
 
 void WSIHandler::setCurrentLevel(int level){
@@ -253,12 +265,3 @@ double WSIHandler::levelDownsample(int level) const {
     }
     return std::pow(2.0, level);
 }
-
-uint qHash(const WSIHandler::TileKey& key, uint seed) noexcept {
-    seed = ::qHash(static_cast<quint64>(key.level), seed);
-    seed = ::qHash(static_cast<quint64>(key.x), seed ^ 0x9e3779b9U);
-    seed = ::qHash(static_cast<quint64>(key.y), seed ^ 0x85ebca6bU);
-    return seed;
-}
-
-
@@ -4,54 +4,93 @@
 #include <QUrl>
 #include <QVector>
 #include <QSize>
+#include <QRect>
 #include <QHash>
 #include <QList>
+#include <QFuture>
+
+#include <memory>
+
+#include "TileSource.h"
+#include "TileCache.h"
+
+class HttpTileSource;
+class OpenSlideTileSource;
 
 class WSIHandler {
 public:
+    using TileFormat = ::TileFormat;
+    using TileUsage = ::TileUsage;
+    using TransferStats = ::TransferStats;
+    using RegionRequest = ::RegionRequest;
+    using TileKey = ::TileKey;
+
+    // tile 网格边长，视图与区域读取共用，保证共享缓存的 key 一致
+    static constexpr int kTileSize = 512;
+
     explicit WSIHandler(const QUrl& backendBase = QUrl("http://127.0.0.1:5001"));
     ~WSIHandler();
 
     bool open(const QString& path);
     bool isOpen() const;
+    // 本地文件优先走进程内 OpenSlide（编译时启用 HAVE_OPENSLIDE），否则经后端读取
+    void setPreferNativeSource(bool prefer) { m_preferNative = prefer; }
+    bool isNativeSource() const;
 
     int levelCount() const { return m_levelCount; }
     QVector<double> levelDownsamples() const { return m_downsamples; }
     QVector<QSize> levelSizes() const { return m_levelDims; }
     QSize levelSize(int level) const;
 
-    QImage requestRegion(int level, qint64 x, qint64 y, int w, int h);
-    QImage readRegionAtCurrentScale(qint64 x0, qint64 y0, int wView, int hView, int level, double viewScale);
+    // 非阻塞读取，由当前 TileSource 完成；失败时结果为空 QImage
+    QFuture<QImage> requestRegionAsync(int level, qint64 x, qint64 y, int w, int h,
+                                       TileUsage usage = TileUsage::Navigation) const;
+    // 批量读取：返回与 regions 一一对应的 future，各自独立完成
+    QVector<QFuture<QImage>> requestRegionsAsync(const QVector<RegionRequest>& regions,
+                                                 TileUsage usage = TileUsage::Navigation,
+                                                 const CancelToken& cancel = CancelToken()) const;
+    // 按 tile 网格拼出 level 坐标下的矩形区域：tile 全部就绪后在线程池中拼接；
+    // 任一 tile 缺失（失败或取消）时结果为空图。
+    // 不提供阻塞版本：解码与拼接都在全局线程池，在池线程上等待结果可能死锁
+    QFuture<QImage> readLevelRegionAsync(int level, const QRect& levelRect,
+                                         TileUsage usage = TileUsage::Navigation,
+                                         const CancelToken& cancel = CancelToken()) const;
+
+    // 读取网格对齐的 tile。导航用途经共享 TileStore / 磁盘缓存：命中直接就绪，在途的共享，
+    // 其余批量请求；识别用途在远程来源下按无损格式直接请求，不读也不写这两级缓存。
+    // cancel 只作用于本次调用返回的 future，取消后以空图结束
+    QVector<QFuture<QImage>> fetchTilesAsync(const QVector<RegionRequest>& regions,
+                                             TileUsage usage = TileUsage::Navigation,
+                                             const CancelToken& cancel = CancelToken()) const;
+    QImage cachedTile(int level, qint64 x, qint64 y) const;
+    TileKey tileKey(int level, qint64 x, qint64 y) const { return TileKey{level, x, y, m_slideToken}; }
     double levelDownsample(int level) const;
     int slideId() const { return m_slideId; }
     int currentLevel() const { return m_currentLevel; }
     void setCurrentLevel(int level);
 
-    struct TileKey {
-        int level{0};
-        qint64 x{0};
-        qint64 y{0};
-        bool operator==(const TileKey& other) const noexcept {
-            return level == other.level && x == other.x && y == other.y;
-        }
-        friend uint qHash(const TileKey& key, uint seed) noexcept;
-    };
+    // 仅作用于后端来源；quality 仅对 JPEG/WebP 有效（1-100）
+    void setTileFormat(TileUsage usage, TileFormat format, int quality = 85);
+    TileFormat tileFormat(TileUsage usage) const;
+    TransferStats transferStats(TileFormat format) const;
+    void resetTransferStats();
 
 private:
-
-
-    void touchTile(const TileKey& key);
-    QImage fetchTile(int level, qint64 x, qint64 y, int w, int h);
     void resetCache();
+    // 该用途能否复用导航 tile：本地来源本身无损，远程导航 tile 可能是有损格式
+    bool sharesNavigationTiles(TileUsage usage) const;
 
-    QUrl m_base;
+    std::unique_ptr<HttpTileSource> m_httpSource;
+    std::unique_ptr<OpenSlideTileSource> m_nativeSource;
+    TileSource* m_source{nullptr};
+    bool m_preferNative{true};
     int m_slideId{-1};
     int m_levelCount{0};
     QVector<QSize> m_levelDims;
     int m_currentLevel{0};
     QVector<double> m_downsamples;
 
-    QHash<TileKey, QImage> m_tileCache;
-    QList<TileKey> m_lru;
-    int m_cacheCapacity{256};
+    int m_slideToken{0};
+    // 磁盘缓存中的切片标识；本地 OpenSlide 来源为空（直接读文件已足够快）
+    QString m_diskSlide;
 };
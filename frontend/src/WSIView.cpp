@@ -1,6 +1,7 @@
 
 #include "WSIView.h"
 #include "WSIHandler.h"
+#include "TileStore.h"
 
 #include <QPainter>
 #include <QWheelEvent>
@@ -10,11 +11,11 @@
 #include <QTimer>
 #include <QPen>
 #include <QBrush>
-#include <QFontMetricsF>
+#include <QStaticText>
 #include <QTransform>
 #include <QHashFunctions>
-#include <QtConcurrent>
-#include <QThread>
+#include <QEvent>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include <algorithm>
 #include <cmath>
@@ -23,6 +24,16 @@
 
 namespace {
 constexpr double kEpsilon = 1e-6;
+
+// 检测叠加层的细节分级：框在屏幕上小于 kMinBoxScreenPx 或可见框超出预算时改画聚合
+constexpr double kMinBoxScreenPx = 4.0;
+constexpr int kMaxBoxesPerFrame = 4000;
+constexpr double kClusterCellPx = 32.0;
+constexpr double kDensityCellPx = 4.0;
+// 框在屏幕上比这更小时不画标签，标签比框本身还大时只会糊成一片
+constexpr double kMinLabelBoxWidthPx = 48.0;
+constexpr double kMinLabelBoxHeightPx = 16.0;
+constexpr int kMaxLabelCacheSize = 4096;
 }
 
 WSIView::WSIView(QWidget* parent) : QWidget(parent) {
@@ -30,20 +41,14 @@ WSIView::WSIView(QWidget* parent) : QWidget(parent) {
     setAutoFillBackground(false);
     setMouseTracking(true);
     setFocusPolicy(Qt::StrongFocus);
-
-    const int idealThreads = QThread::idealThreadCount();
-    if (idealThreads > 0) {
-        m_tileThreadPool.setMaxThreadCount(std::max(2, idealThreads));
-    } else {
-        m_tileThreadPool.setMaxThreadCount(4);
-    }
-    m_tileThreadPool.setExpiryTimeout(3000);
+    m_scheduler.setDispatcher([this](const QVector<TileScheduler::Request>& batch) {
+        dispatchTiles(batch);
+    });
 }
 
 WSIView::~WSIView() {
     ++m_generation;
     cancelPendingFetches();
-    m_tileThreadPool.waitForDone();
 }
 
 void WSIView::setHandler(WSIHandler* handler) {
@@ -66,12 +71,19 @@ void WSIView::setSlideInfo(const QVector<double>& downsamples, const QVector<QSi
     m_pendingRequest = false;
     m_requestTimer.invalidate();
 
-    m_tileCache.clear();
-    m_tileLru.clear();
     m_miniMapImage = QImage();
     m_miniMapLevel = -1;
     m_miniMapDownsample = 1.0;
 
+    // 旧切片的热力图立即作废，在途的构建完成后也会被丢弃
+    ++m_heatmapGeneration;
+    m_heatPyramid.reset();
+    m_heatTiles.clear();
+    m_heatmapDirty = true;
+    if (m_heatmapVisible) {
+        rebuildHeatmap();
+    }
+
     emit miniMapReady(QImage(), 1.0, QSize());
 
     if (m_hasSlide && m_handler) {
@@ -94,18 +106,122 @@ bool WSIView::isEmpty() const {
     return !m_hasSlide;
 }
 
-void WSIView::setDetections(const QVector<DetBox>& boxes) {
-    m_detectionBoxes = boxes;
+void WSIView::setDetections(const DetectionResult& result) {
+    const quint64 serial = ++m_detectionSerial;
+    if (result.isEmpty()) {
+        // 清空没有可建的东西，立即生效并作废在途的构建
+        m_pendingDetections = DetectionResult();
+        m_detectionsDirty = false;
+        m_shownDetectionSerial = serial;
+        m_detections = result;
+        m_detectionIndex.build(m_detections);
+        m_detectionLod.build(m_detections);
+        m_heatmapDirty = true;
+        if (m_heatmapVisible) {
+            rebuildHeatmap();
+        }
+        update();
+        return;
+    }
+    m_pendingDetections = result;
+    m_detectionsDirty = true;
+    if (!m_detectionBuilding) {
+        rebuildDetectionIndex();
+    }
+}
+
+void WSIView::rebuildDetectionIndex() {
+    struct Built {
+        DetectionResult result;
+        DetectionIndex index;
+        DetectionLod lod;
+    };
+    using BuiltPtr = std::shared_ptr<Built>;
+
+    m_detectionsDirty = false;
+    m_detectionBuilding = true;
+    const quint64 serial = m_detectionSerial;
+    auto* watcher = new QFutureWatcher<BuiltPtr>(this);
+    QObject::connect(watcher, &QFutureWatcher<BuiltPtr>::finished, this, [this, watcher, serial]() {
+        watcher->deleteLater();
+        m_detectionBuilding = false;
+        if (serial > m_shownDetectionSerial) {
+            const BuiltPtr built = watcher->future().result();
+            m_shownDetectionSerial = serial;
+            m_detections = std::move(built->result);
+            m_detectionIndex = std::move(built->index);
+            m_detectionLod = std::move(built->lod);
+            m_heatmapDirty = true;
+            if (m_heatmapVisible) {
+                rebuildHeatmap();
+            }
+            update();
+        }
+        if (m_detectionsDirty) {
+            rebuildDetectionIndex();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([result = std::exchange(m_pendingDetections, DetectionResult())]() {
+        auto built = std::make_shared<Built>();
+        built->result = result;
+        built->index.build(built->result);
+        built->lod.build(built->result);
+        return built;
+    }));
+}
+
+void WSIView::setHeatmapVisible(bool visible) {
+    m_heatmapVisible = visible;
+    if (visible && m_heatmapDirty) {
+        rebuildHeatmap();
+    }
+    update();
+}
+
+void WSIView::setHeatmapOpacity(double opacity) {
+    m_heatmapOpacity = std::clamp(opacity, 0.0, 1.0);
     update();
 }
 
-QImage WSIView::grabViewportImage() const {
-    if (width() <= 0 || height() <= 0) return QImage();
-    QImage img(size(), QImage::Format_ARGB32_Premultiplied);
-    img.fill(Qt::white);
-    QPainter painter(&img);
-    const_cast<WSIView*>(this)->render(&painter);
-    return img;
+void WSIView::rebuildHeatmap() {
+    if (m_detections.isEmpty() || !m_hasSlide) {
+        m_heatmapDirty = false;
+        ++m_heatmapGeneration;
+        m_heatPyramid.reset();
+        m_heatTiles.clear();
+        return;
+    }
+    // 上一份还在建时不再并行开新的，完成后按最新结果补建一次；旧的热力图保留到新的建好
+    if (m_heatmapBuilding) {
+        m_heatmapDirty = true;
+        return;
+    }
+    m_heatmapDirty = false;
+    m_heatmapBuilding = true;
+    const quint64 generation = ++m_heatmapGeneration;
+
+    using PyramidPtr = std::shared_ptr<const HeatmapPyramid>;
+    auto* watcher = new QFutureWatcher<PyramidPtr>(this);
+    QObject::connect(watcher, &QFutureWatcher<PyramidPtr>::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        m_heatmapBuilding = false;
+        if (generation == m_heatmapGeneration) {
+            m_heatPyramid = watcher->future().result();
+            m_heatTiles.clear();
+            update();
+        }
+        if (m_heatmapDirty && m_heatmapVisible) {
+            rebuildHeatmap();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(&HeatmapPyramid::build, m_detections, m_canvasSize, m_downsamples));
+}
+
+int WSIView::detectionAt(const QPointF& viewPos) const {
+    if (m_detectionIndex.isEmpty() || m_viewScale <= 0.0) return -1;
+    const QPointF world = viewPos / m_viewScale + m_worldTopLeft;
+    // 屏幕上 3px 的容差，缩小时小框也点得中
+    return m_detectionIndex.hitTest(world, 3.0 / m_viewScale);
 }
 
 QRectF WSIView::viewWorldRect() const {
@@ -175,20 +291,21 @@ void WSIView::paintEvent(QPaintEvent* event) {
                 for (qint64 tx = tileXStart; tx < tileXEnd; tx += m_tileSize) {
                     const int tileW = static_cast<int>(std::min<qint64>(m_tileSize, levelSize.width() - tx));
                     if (tileW <= 0) continue;
-                    const TileKey key{m_currentLevel, tx, ty};
-                    auto it = m_tileCache.constFind(key);
-                    if (it != m_tileCache.constEnd() && !it.value().isNull()) {
-                        const QImage& tile = it.value();
-                        touchTile(key);
+                    const TileKey key = m_handler ? m_handler->tileKey(m_currentLevel, tx, ty) : TileKey();
+                    const QImage tile = m_handler ? m_handler->cachedTile(m_currentLevel, tx, ty) : QImage();
+                    if (!tile.isNull()) {
                         QRectF tileWorldRect(QPointF(tx * downsample, ty * downsample),
                                              QSizeF(tile.width() * downsample, tile.height() * downsample));
                         const QRectF destRect = worldToScreen(tileWorldRect);
-                        painter.drawImage(destRect, tile);
+                        drawTile(painter, key, tile, destRect, m_viewScale * downsample);
                     } else {
                         QRectF tileWorldRect(QPointF(tx * downsample, ty * downsample),
                                              QSizeF(tileW * downsample, tileH * downsample));
-                        const QRectF destRect = worldToScreen(tileWorldRect);
-                        painter.fillRect(destRect, QColor(60, 60, 60, 90));
+                        // 先借用其他 level 已缓存的 tile，新 tile 到达后重绘即原地替换
+                        if (!drawFallbackTile(painter, tileWorldRect)) {
+                            const QRectF destRect = worldToScreen(tileWorldRect);
+                            painter.fillRect(destRect, QColor(60, 60, 60, 90));
+                        }
                     }
                 }
             }
@@ -196,6 +313,7 @@ void WSIView::paintEvent(QPaintEvent* event) {
     }
 
     painter.restore();
+    drawHeatmapOverlay(painter);
     drawDetections(painter);
 }
 
@@ -226,6 +344,9 @@ void WSIView::wheelEvent(QWheelEvent* event) {
         m_currentLevel = newLevel;
         emit levelChanged(m_currentLevel);
     }
+    // 放大朝更精细的 level 走，缩小朝更粗的
+    m_zoomTarget = std::clamp(newLevel + (factor > 1.0 ? -1 : 1), 0, std::max(0, m_levelCount - 1));
+    m_zoomClock.start();
 
     m_worldTopLeft = worldBefore - (cursorPos / m_viewScale);
     clampWorldTopLeft();
@@ -243,6 +364,9 @@ void WSIView::mousePressEvent(QMouseEvent* event) {
     if (event->button() == Qt::LeftButton || event->button() == Qt::RightButton || event->button() == Qt::MiddleButton) {
         m_isPanning = true;
         m_lastMousePos = event->pos();
+        m_pressPos = event->pos();
+        m_panVelocity = QPointF();
+        m_panClock.start();
         setCursor(Qt::ClosedHandCursor);
         event->accept();
         return;
@@ -254,7 +378,12 @@ void WSIView::mouseMoveEvent(QMouseEvent* event) {
     if (m_isPanning) {
         const QPoint delta = event->pos() - m_lastMousePos;
         m_lastMousePos = event->pos();
-        m_worldTopLeft -= QPointF(delta) / m_viewScale;
+        const QPointF worldDelta = -QPointF(delta) / m_viewScale;
+        const qint64 dt = m_panClock.isValid() ? m_panClock.restart() : 0;
+        if (dt > 0) {
+            m_panVelocity = m_panVelocity * 0.4 + (worldDelta / static_cast<double>(dt)) * 0.6;
+        }
+        m_worldTopLeft += worldDelta;
         clampWorldTopLeft();
         scheduleRepaint();
         event->accept();
@@ -266,7 +395,14 @@ void WSIView::mouseMoveEvent(QMouseEvent* event) {
 void WSIView::mouseReleaseEvent(QMouseEvent* event) {
      if (m_isPanning && (event->button() == Qt::LeftButton || event->button() == Qt::RightButton || event->button() == Qt::MiddleButton)) {
         m_isPanning = false;
+        m_panVelocity = QPointF();
         setCursor(Qt::ArrowCursor);
+        if (event->button() == Qt::LeftButton && (event->pos() - m_pressPos).manhattanLength() <= 3) {
+            const int hit = detectionAt(event->position());
+            if (hit >= 0) {
+                emit detectionClicked(hit);
+            }
+        }
         scheduleRepaint(true);
         event->accept();
         return;
@@ -288,19 +424,10 @@ void WSIView::resizeEvent(QResizeEvent* event) {
     scheduleRepaint(true);
 }
 
-void WSIView::touchTile(const TileKey& key) {
-    const int idx = m_tileLru.indexOf(key);
-    if (idx >= 0) {
-        m_tileLru.removeAt(idx);
-    }
-    m_tileLru.prepend(key);
-    pruneCache();
-}
-
-void WSIView::pruneCache() {
-    while (m_tileLru.size() > m_tileCacheCapacity) {
-        const TileKey last = m_tileLru.takeLast();
-        m_tileCache.remove(last);
+void WSIView::changeEvent(QEvent* event) {
+    QWidget::changeEvent(event);
+    if (event->type() == QEvent::FontChange) {
+        m_labelCache.clear();
     }
 }
 
@@ -402,22 +529,39 @@ void WSIView::updateVisibleTiles(bool forceRequest) {
     if (!m_handler || !m_hasSlide || width() <= 0 || height() <= 0) return;
     if (m_currentLevel < 0 || m_currentLevel >= m_levelCount) return;
 
+    // 视口变了：先按新视口重排已排队的请求，离开视野或已换 level 的直接丢弃
+    m_scheduler.reprioritize([this](const TileKey& key) { return tilePriority(key); });
+
     QRectF worldRect = currentWorldRect();
     if (worldRect.isEmpty()) return;
 
     const double marginX = worldRect.width() * 0.2;
     const double marginY = worldRect.height() * 0.2;
-    worldRect.adjust(-marginX, -marginY, marginX, marginY);
+    enqueueTiles(m_currentLevel, worldRect.adjusted(-marginX, -marginY, marginX, marginY));
+
+    // 预取：沿拖动方向的前方视口，以及正在缩放前往的相邻 level
+    const QRectF ahead = predictedWorldRect();
+    if (!ahead.isEmpty()) {
+        enqueueTiles(m_currentLevel, ahead);
+    }
+    const int target = zoomTargetLevel();
+    if (target >= 0) {
+        enqueueTiles(target, worldRect);
+    }
+    m_scheduler.pump();
+}
+
+void WSIView::enqueueTiles(int level, const QRectF& area) {
     const QRectF slideRect(QPointF(0.0, 0.0), QSizeF(m_canvasSize));
-    worldRect = worldRect.intersected(slideRect);
+    const QRectF worldRect = area.intersected(slideRect);
     if (worldRect.isEmpty()) return;
 
-    const double downsample = (m_currentLevel >= 0 && m_currentLevel < m_downsamples.size() && m_downsamples[m_currentLevel] > 0.0)
-                                  ? m_downsamples[m_currentLevel]
-                                  : std::pow(2.0, m_currentLevel);
+    const double downsample = (level >= 0 && level < m_downsamples.size() && m_downsamples[level] > 0.0)
+                                  ? m_downsamples[level]
+                                  : std::pow(2.0, level);
     if (downsample <= 0.0) return;
 
-    const QSize levelSize = m_levelSizes.value(m_currentLevel);
+    const QSize levelSize = m_levelSizes.value(level);
     if (levelSize.width() <= 0 || levelSize.height() <= 0) return;
 
     const double levelLeft = worldRect.left() / downsample;
@@ -441,39 +585,106 @@ void WSIView::updateVisibleTiles(bool forceRequest) {
         for (qint64 tx = tileXStart; tx < tileXEnd; tx += m_tileSize) {
             const int tileW = static_cast<int>(std::min<qint64>(m_tileSize, levelSize.width() - tx));
             if (tileW <= 0) continue;
-            const TileKey key{m_currentLevel, tx, ty};
-            if (m_tileCache.contains(key)) {
+            const TileKey key = m_handler->tileKey(level, tx, ty);
+            if (TileStore::instance().contains(key)) {
                 continue;
             }
             if (m_pendingFetches.contains(key)) {
                 continue;
             }
-            requestTile(key, tileW, tileH);
+            m_scheduler.enqueue(key, {key.level, key.x, key.y, tileW, tileH}, tilePriority(key));
         }
     }
 }
 
-void WSIView::requestTile(const TileKey& key, int tileW, int tileH) {
-    if (!m_handler || tileW <= 0 || tileH <= 0) return;
+QRectF WSIView::predictedWorldRect() const {
+    // 超过 150ms 没有移动视为已停下
+    if (!m_isPanning || !m_panClock.isValid() || m_panClock.elapsed() > 150) return QRectF();
+    const QPointF shift = m_panVelocity * static_cast<double>(m_prefetchLookaheadMs);
+    if (std::abs(shift.x()) * m_viewScale < 1.0 && std::abs(shift.y()) * m_viewScale < 1.0) return QRectF();
+    return currentWorldRect().translated(shift);
+}
+
+int WSIView::zoomTargetLevel() const {
+    if (m_zoomTarget < 0 || m_zoomTarget == m_currentLevel || m_zoomTarget >= m_levelCount) return -1;
+    if (!m_zoomClock.isValid() || m_zoomClock.elapsed() > 600) return -1;
+    return m_zoomTarget;
+}
+
+double WSIView::tilePriority(const TileKey& key) const {
+    const QRectF viewRect = currentWorldRect();
+    if (viewRect.isEmpty()) return -1.0;
+
+    const double downsample = (key.level >= 0 && key.level < m_downsamples.size() && m_downsamples[key.level] > 0.0)
+                                  ? m_downsamples[key.level]
+                                  : std::pow(2.0, key.level);
+    const QRectF tileRect(QPointF(key.x * downsample, key.y * downsample),
+                          QSizeF(m_tileSize * downsample, m_tileSize * downsample));
+    const QPointF delta = (tileRect.center() - viewRect.center()) * m_viewScale;
+    const double distance = std::hypot(delta.x(), delta.y());
+
+    if (key.level != m_currentLevel) {
+        if (key.level == zoomTargetLevel() && tileRect.intersects(viewRect)) {
+            return TileScheduler::kPrefetchBand + distance;
+        }
+        return -1.0;
+    }
+
+    // 可见的一律排在边缘之前，预取最后；同段按到视口中心的屏幕距离
+    if (tileRect.intersects(viewRect)) {
+        return TileScheduler::kVisibleBand + distance;
+    }
+    const QRectF marginRect = viewRect.adjusted(-viewRect.width() * 0.2, -viewRect.height() * 0.2,
+                                                viewRect.width() * 0.2, viewRect.height() * 0.2);
+    if (tileRect.intersects(marginRect)) {
+        return TileScheduler::kMarginBand + distance;
+    }
+    const QRectF ahead = predictedWorldRect();
+    if (!ahead.isEmpty() && tileRect.intersects(ahead)) {
+        return TileScheduler::kPrefetchBand + distance;
+    }
+    return -1.0;
+}
+
+void WSIView::dispatchTiles(const QVector<TileScheduler::Request>& batch) {
+    if (!m_handler) {
+        for (const auto& request : batch) {
+            m_scheduler.finished(request.key);
+        }
+        return;
+    }
+
+    // 每批一个 HTTP 请求，多批之间仍可并行，tile 随帧到达逐个显示
+    QVector<WSIHandler::RegionRequest> regions;
+    regions.reserve(batch.size());
+    for (const auto& request : batch) {
+        regions.push_back(request.region);
+    }
+    const auto futures = m_handler->fetchTilesAsync(regions, TileUsage::Navigation, m_fetchCancel);
+    for (int i = 0; i < futures.size(); ++i) {
+        watchTile(batch[i].key, futures[i]);
+    }
+}
+
+void WSIView::watchTile(const TileKey& key, const QFuture<QImage>& future) {
     if (m_pendingFetches.contains(key)) return;
 
     auto* watcher = new QFutureWatcher<QImage>(this);
     const quint64 generation = m_generation;
-    auto future = QtConcurrent::run(&m_tileThreadPool, [handler = m_handler, key, tileW, tileH]() -> QImage {
-        if (!handler) return QImage();
-        return handler->requestRegion(key.level, key.x, key.y, tileW, tileH);
-    });
     m_pendingFetches.insert(key, watcher);
     QObject::connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, key, generation]() {
-        QImage tile = watcher->future().result();
-        m_pendingFetches.remove(key);
+        const QFuture<QImage> finished = watcher->future();
+        const QImage tile = (!finished.isCanceled() && finished.resultCount() > 0) ? finished.result() : QImage();
+        if (m_pendingFetches.value(key) == watcher) {
+            m_pendingFetches.remove(key);
+        }
         watcher->deleteLater();
         if (generation != m_generation) {
             return;
         }
+        m_scheduler.finished(key);
+        // tile 已由 TileStore 缓存，这里只需重绘
         if (!tile.isNull()) {
-            m_tileCache.insert(key, tile);
-            touchTile(key);
             update();
         }
     });
@@ -481,13 +692,21 @@ void WSIView::requestTile(const TileKey& key, int tileW, int tileH) {
 }
 
 void WSIView::cancelPendingFetches() {
+    // 不等待：本视图的 future 立即以空图结束；底层请求仅在没有其他调用方等待时 abort，
+    // 迟到的结果由 m_generation 丢弃
+    m_fetchCancel.cancel();
+    m_fetchCancel = CancelToken();
+    m_scheduler.clear();
     for (auto watcher : std::as_const(m_pendingFetches)) {
-        if (!watcher) continue;
-        watcher->cancel();
-        watcher->waitForFinished();
-        watcher->deleteLater();
+        if (watcher) watcher->deleteLater();
     }
     m_pendingFetches.clear();
+    for (auto watcher : std::as_const(m_pendingScales)) {
+        if (watcher) watcher->deleteLater();
+    }
+    m_pendingScales.clear();
+    m_scaledTiles.clear();
+    m_scaledFactor = 0.0;
 }
 
 QRectF WSIView::worldToScreen(const QRectF& rect) const {
@@ -497,31 +716,282 @@ QRectF WSIView::worldToScreen(const QRectF& rect) const {
 }
 
 void WSIView::drawDetections(QPainter& painter) {
-    if (m_detectionBoxes.isEmpty()) return;
+    if (m_detections.isEmpty() || m_viewScale <= 0.0) return;
+
+    const QRectF visibleWorld(m_worldTopLeft, QSizeF(width() / m_viewScale, height() / m_viewScale));
+    const double boxPx = m_detectionLod.typicalBoxSize() * m_viewScale;
+    if (boxPx >= kMinBoxScreenPx) {
+        // 只取与当前视口相交的框，开销与可见数量成正比
+        m_visibleDetections.clear();
+        m_detectionIndex.query(visibleWorld, &m_visibleDetections);
+        if (m_visibleDetections.size() <= kMaxBoxesPerFrame) {
+            drawDetectionBoxes(painter);
+            return;
+        }
+    }
+    if (boxPx >= 1.0) {
+        drawDetectionClusters(painter, visibleWorld);
+    } else {
+        drawDetectionDensity(painter, visibleWorld);
+    }
+}
 
+void WSIView::drawDetectionBoxes(QPainter& painter) {
     painter.save();
     QPen pen(Qt::red);
     pen.setWidthF(1.5);
     painter.setPen(pen);
-    const QRectF viewportRect(QPointF(0, 0), QSizeF(width(), height()));
 
-    for (const auto& box : m_detectionBoxes) {
-        const QRectF screenRect = worldToScreen(box.rect);
-        if (!screenRect.intersects(viewportRect)) continue;
-        painter.drawRect(screenRect);
-        if (!box.label.isEmpty()) {
-            const QString text = QStringLiteral("%1 (%.2f)").arg(box.label).arg(box.score);
-            QFontMetricsF metrics(painter.font());
-            const QSizeF textSize(metrics.horizontalAdvance(text) + 6.0, metrics.height() + 4.0);
-            QPointF textPos = screenRect.topLeft() - QPointF(0.0, textSize.height() + 2.0);
-            if (textPos.y() < 0.0) {
-                textPos.setY(screenRect.bottom() + 2.0);
+    for (int index : std::as_const(m_visibleDetections)) {
+        painter.drawRect(worldToScreen(m_detections.rect(index)));
+    }
+
+    // 标签单独一遍：少切换画笔，且只给足够大的框画
+    const QFont font = painter.font();
+    for (int index : std::as_const(m_visibleDetections)) {
+        const QString label = m_detections.label(index);
+        if (label.isEmpty()) continue;
+        const QRectF screenRect = worldToScreen(m_detections.rect(index));
+        if (screenRect.width() < kMinLabelBoxWidthPx || screenRect.height() < kMinLabelBoxHeightPx) continue;
+
+        const LabelGlyph& glyph = labelGlyph(label, m_detections.score(index), font);
+        const QSizeF textSize(glyph.size.width() + 6.0, glyph.size.height() + 4.0);
+        QPointF textPos = screenRect.topLeft() - QPointF(0.0, textSize.height() + 2.0);
+        if (textPos.y() < 0.0) {
+            textPos.setY(screenRect.bottom() + 2.0);
+        }
+        painter.fillRect(QRectF(textPos, textSize), QColor(0, 0, 0, 180));
+        painter.setPen(Qt::white);
+        painter.drawStaticText(textPos + QPointF(3.0, 2.0), glyph.text);
+    }
+    painter.restore();
+}
+
+const WSIView::LabelGlyph& WSIView::labelGlyph(const QString& label, float score, const QFont& font) {
+    // 命中时不做任何字符串格式化
+    const LabelKey key(label, qRound(score * 100.0f));
+    auto it = m_labelCache.find(key);
+    if (it != m_labelCache.end()) {
+        return it.value();
+    }
+    if (m_labelCache.size() >= kMaxLabelCacheSize) {
+        m_labelCache.clear();
+    }
+    const QString text = QStringLiteral("%1 (%2)").arg(label).arg(key.second / 100.0, 0, 'f', 2);
+    LabelGlyph glyph;
+    glyph.text.setText(text);
+    glyph.text.setTextFormat(Qt::PlainText);
+    glyph.text.setPerformanceHint(QStaticText::AggressiveCaching);
+    glyph.text.prepare(QTransform(), font);
+    glyph.size = glyph.text.size();
+    return m_labelCache.insert(key, glyph).value();
+}
+
+void WSIView::drawDetectionClusters(QPainter& painter, const QRectF& visibleWorld) {
+    // 格子在屏幕上不小于 32px，一屏的聚类符号数量有上限
+    const int level = m_detectionLod.levelForScale(m_viewScale, kClusterCellPx);
+    m_visibleCells.clear();
+    m_detectionLod.query(level, visibleWorld, &m_visibleCells);
+    if (m_visibleCells.isEmpty()) return;
+
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setPen(QPen(QColor(255, 255, 255, 200), 1.0));
+    for (const auto& cell : std::as_const(m_visibleCells)) {
+        const QPointF center = (cell.centroid - m_worldTopLeft) * m_viewScale;
+        const double radius = std::clamp(3.0 + 2.5 * std::log2(static_cast<double>(cell.count)), 3.0, 14.0);
+        // 颜色随格内最高分由黄变红
+        const double score = std::clamp(static_cast<double>(cell.maxScore), 0.0, 1.0);
+        painter.setBrush(QColor::fromHsvF((1.0 - score) * 60.0 / 360.0, 0.9, 1.0, 0.7));
+        painter.drawEllipse(center, radius, radius);
+        if (cell.count >= 10 && radius >= 9.0) {
+            painter.drawText(QRectF(center.x() - radius, center.y() - radius, radius * 2.0, radius * 2.0),
+                             Qt::AlignCenter, QString::number(cell.count));
+        }
+    }
+    painter.restore();
+}
+
+void WSIView::drawDetectionDensity(QPainter& painter, const QRectF& visibleWorld) {
+    const int level = m_detectionLod.levelForScale(m_viewScale, kDensityCellPx);
+    m_visibleCells.clear();
+    m_detectionLod.query(level, visibleWorld, &m_visibleCells);
+    if (m_visibleCells.isEmpty()) return;
+
+    // 一格一个像素画进小图，再整体放大贴上，开销只取决于视口大小
+    int minCol = std::numeric_limits<int>::max(), maxCol = std::numeric_limits<int>::min();
+    int minRow = std::numeric_limits<int>::max(), maxRow = std::numeric_limits<int>::min();
+    for (const auto& cell : std::as_const(m_visibleCells)) {
+        minCol = std::min(minCol, cell.col);
+        maxCol = std::max(maxCol, cell.col);
+        minRow = std::min(minRow, cell.row);
+        maxRow = std::max(maxRow, cell.row);
+    }
+    QImage density(maxCol - minCol + 1, maxRow - minRow + 1, QImage::Format_ARGB32_Premultiplied);
+    if (density.isNull()) return;
+    density.fill(Qt::transparent);
+    const double norm = std::log1p(static_cast<double>(std::max(1, m_detectionLod.maxCount(level))));
+    for (const auto& cell : std::as_const(m_visibleCells)) {
+        const double t = std::log1p(static_cast<double>(cell.count)) / norm;
+        const int alpha = std::clamp(static_cast<int>(60.0 + 180.0 * t), 0, 255);
+        density.setPixel(cell.col - minCol, cell.row - minRow, qPremultiply(qRgba(255, 40, 40, alpha)));
+    }
+
+    const QRectF worldRect = m_detectionLod.cellRect(level, minCol, minRow)
+                                 .united(m_detectionLod.cellRect(level, maxCol, maxRow));
+    painter.save();
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter.drawImage(worldToScreen(worldRect), density);
+    painter.restore();
+}
+
+void WSIView::drawTile(QPainter& painter, const TileKey& key, const QImage& tile, const QRectF& destRect, double factor) {
+    const QPoint origin(qRound(destRect.left()), qRound(destRect.top()));
+    if (std::abs(factor - 1.0) < 1e-3) {
+        painter.drawImage(origin, tile);
+        return;
+    }
+
+    if (factor != m_scaledFactor) {
+        // 倍率变了，旧的预缩放结果全部作废；在途的由 finished 里比对倍率丢弃
+        m_scaledTiles.clear();
+        m_scaledFactor = factor;
+    }
+    // 向上取整，相邻 tile 最多重叠 1px，避免取整产生的缝
+    const QSize size(static_cast<int>(std::ceil(tile.width() * factor)),
+                     static_cast<int>(std::ceil(tile.height() * factor)));
+    const QImage scaled = m_scaledTiles.value(key);
+    if (scaled.size() == size) {
+        painter.drawImage(origin, scaled);
+        return;
+    }
+    painter.drawImage(destRect, tile);
+    // 滚轮缩放过程中倍率每帧都在变，停下后再生成
+    if (!m_zoomClock.isValid() || m_zoomClock.elapsed() > 150) {
+        requestScaledTile(key, tile, size);
+    }
+}
+
+void WSIView::requestScaledTile(const TileKey& key, const QImage& tile, const QSize& size) {
+    if (m_pendingScales.contains(key) || size.isEmpty()) return;
+
+    auto* watcher = new QFutureWatcher<QImage>(this);
+    const double factor = m_scaledFactor;
+    const quint64 generation = m_generation;
+    m_pendingScales.insert(key, watcher);
+    QObject::connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, key, factor, generation]() {
+        if (m_pendingScales.value(key) == watcher) {
+            m_pendingScales.remove(key);
+        }
+        watcher->deleteLater();
+        if (generation != m_generation || factor != m_scaledFactor) {
+            return;
+        }
+        const QImage scaled = watcher->future().result();
+        if (!scaled.isNull()) {
+            // 只为视口附近服务，平移很远后整体重建即可
+            if (m_scaledTiles.size() >= 256) {
+                m_scaledTiles.clear();
+            }
+            m_scaledTiles.insert(key, scaled);
+            update();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([tile, size]() {
+        return tile.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }));
+}
+
+bool WSIView::drawFallbackTile(QPainter& painter, const QRectF& worldRect) {
+    if (!m_handler) return false;
+    // 由近及远交替尝试更粗（放大）与更细（缩小）的 level；更细的最多两级，避免一次画太多 tile
+    constexpr int kMaxFinerSteps = 2;
+    for (int step = 1; step < m_levelCount; ++step) {
+        const int coarser = m_currentLevel + step;
+        if (coarser < m_levelCount && drawCachedCover(painter, coarser, worldRect)) {
+            return true;
+        }
+        const int finer = m_currentLevel - step;
+        if (step <= kMaxFinerSteps && finer >= 0 && drawCachedCover(painter, finer, worldRect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WSIView::drawCachedCover(QPainter& painter, int level, const QRectF& worldRect) {
+    const QSize levelSize = m_levelSizes.value(level);
+    const double downsample = (level >= 0 && level < m_downsamples.size() && m_downsamples[level] > 0.0)
+                                  ? m_downsamples[level]
+                                  : std::pow(2.0, level);
+    if (levelSize.width() <= 0 || levelSize.height() <= 0 || downsample <= 0.0) return false;
+
+    const qint64 tileXStart = std::max<qint64>(0, static_cast<qint64>(std::floor(worldRect.left() / downsample / m_tileSize)) * m_tileSize);
+    const qint64 tileYStart = std::max<qint64>(0, static_cast<qint64>(std::floor(worldRect.top() / downsample / m_tileSize)) * m_tileSize);
+    const qint64 tileXEnd = std::min<qint64>(levelSize.width(), static_cast<qint64>(std::ceil(worldRect.right() / downsample)));
+    const qint64 tileYEnd = std::min<qint64>(levelSize.height(), static_cast<qint64>(std::ceil(worldRect.bottom() / downsample)));
+    if (tileXEnd <= tileXStart || tileYEnd <= tileYStart) return false;
+
+    // 必须整块覆盖才使用，否则会在画面上留下拼接缝
+    QVector<std::pair<QRectF, QImage>> cover;
+    for (qint64 ty = tileYStart; ty < tileYEnd; ty += m_tileSize) {
+        for (qint64 tx = tileXStart; tx < tileXEnd; tx += m_tileSize) {
+            const QImage tile = m_handler->cachedTile(level, tx, ty);
+            if (tile.isNull()) return false;
+            const QRectF tileWorld(QPointF(tx * downsample, ty * downsample),
+                                   QSizeF(tile.width() * downsample, tile.height() * downsample));
+            cover.push_back({tileWorld, tile});
+        }
+    }
+
+    for (const auto& [tileWorld, tile] : std::as_const(cover)) {
+        const QRectF part = tileWorld.intersected(worldRect);
+        if (part.isEmpty()) continue;
+        const QRectF source((part.topLeft() - tileWorld.topLeft()) / downsample, part.size() / downsample);
+        painter.drawImage(worldToScreen(part), tile, source);
+    }
+    return true;
+}
+
+void WSIView::drawHeatmapOverlay(QPainter& painter) {
+    if (!m_heatmapVisible || !m_heatPyramid || m_heatmapOpacity <= 0.0) return;
+    const int level = m_heatPyramid->levelForScale(m_viewScale);
+    if (level < 0) return;
+
+    const QRectF worldRect = currentWorldRect();
+    const double cell = m_heatPyramid->cellSize(level);
+    const QSize grid = m_heatPyramid->gridSize(level);
+    const double tileWorld = cell * HeatmapPyramid::kTileSize;
+    const int tx0 = std::max(0, static_cast<int>(std::floor(worldRect.left() / tileWorld)));
+    const int ty0 = std::max(0, static_cast<int>(std::floor(worldRect.top() / tileWorld)));
+    const int tx1 = std::min((grid.width() - 1) / HeatmapPyramid::kTileSize,
+                             static_cast<int>(std::floor(worldRect.right() / tileWorld)));
+    const int ty1 = std::min((grid.height() - 1) / HeatmapPyramid::kTileSize,
+                             static_cast<int>(std::floor(worldRect.bottom() / tileWorld)));
+    if (tx1 < tx0 || ty1 < ty0) return;
+
+    // 约 48MB 上限；缩放跨层后旧层的 tile 整体丢弃
+    constexpr int kMaxHeatTiles = 192;
+    const int needed = (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    if (m_heatTiles.size() + needed > kMaxHeatTiles) {
+        m_heatTiles.clear();
+    }
+
+    painter.save();
+    painter.setOpacity(m_heatmapOpacity);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            const quint64 key = (static_cast<quint64>(level) << 48) | (static_cast<quint64>(ty) << 24) | static_cast<quint64>(tx);
+            auto it = m_heatTiles.find(key);
+            if (it == m_heatTiles.end()) {
+                // 着色只是查表，首帧同步生成即可
+                it = m_heatTiles.insert(key, m_heatPyramid->renderTile(level, tx, ty));
             }
-            QRectF textRect(textPos, textSize);
-            painter.fillRect(textRect, QColor(0, 0, 0, 180));
-            painter.setPen(Qt::white);
-            painter.drawText(textRect.adjusted(3.0, 0.0, -3.0, 0.0), Qt::AlignVCenter | Qt::AlignLeft, text);
-            painter.setPen(pen);
+            const QImage& tile = it.value();
+            if (tile.isNull()) continue;
+            const QRectF world(tx * tileWorld, ty * tileWorld, tile.width() * cell, tile.height() * cell);
+            painter.drawImage(worldToScreen(world), tile);
         }
     }
     painter.restore();
@@ -577,23 +1047,17 @@ void WSIView::prepareMiniMap() {
         return;
     }
 
-    QImage mini = m_handler->requestRegion(level, 0, 0, levelSize.width(), levelSize.height());
-    if (mini.isNull()) {
-        emit miniMapReady(m_miniMapImage, m_miniMapDownsample, m_canvasSize);
-        return;
-    }
-
-    m_miniMapImage = mini;
-    m_miniMapLevel = level;
-    m_miniMapDownsample = m_handler->levelDownsample(level);
-    if (m_miniMapDownsample <= 0.0) {
-        m_miniMapDownsample = std::pow(2.0, level);
-    }
-    emit miniMapReady(m_miniMapImage, m_miniMapDownsample, m_canvasSize);
-}
-uint qHash(const WSIView::TileKey& key, uint seed) noexcept {
-    seed = ::qHash(static_cast<quint64>(key.level), seed);
-    seed = ::qHash(static_cast<quint64>(key.x), seed ^ 0x9e3779b9U);
-    seed = ::qHash(static_cast<quint64>(key.y), seed ^ 0x85ebca6bU);
-    return seed;
+    // 不阻塞换片：小地图层级读完后再回到 GUI 线程；期间换片或析构的结果丢弃
+    const quint64 generation = m_generation;
+    m_handler->readLevelRegionAsync(level, QRect(QPoint(0, 0), levelSize), TileUsage::Navigation, m_fetchCancel)
+        .then(this, [this, generation, level](const QImage& mini) {
+            if (generation != m_generation || mini.isNull()) return;
+            m_miniMapImage = mini;
+            m_miniMapLevel = level;
+            m_miniMapDownsample = m_handler ? m_handler->levelDownsample(level) : 0.0;
+            if (m_miniMapDownsample <= 0.0) {
+                m_miniMapDownsample = std::pow(2.0, level);
+            }
+            emit miniMapReady(m_miniMapImage, m_miniMapDownsample, m_canvasSize);
+        });
 }
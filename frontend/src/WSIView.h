@@ -10,26 +10,26 @@
 #include <QRect>
 #include <QHash>
 #include <QList>
+#include <QPair>
 #include <QFutureWatcher>
-#include <QThreadPool>
+#include <QStaticText>
 
-#include "DetectionResult.h"   // 唯一的 DetBox 定义
+#include <memory>
+
+#include "DetectionResult.h"
+#include "WSIHandler.h"
+#include "TileScheduler.h"
+#include "DetectionIndex.h"
+#include "DetectionLod.h"
+#include "HeatmapPyramid.h"
 
 class QPainter;
-class WSIHandler;
 
 class WSIView : public QWidget {
     Q_OBJECT
 public:
 
-    struct TileKey {
-        int level{0};
-        qint64 x{0};
-        qint64 y{0};
-        bool operator==(const TileKey& other) const noexcept {
-            return level == other.level && x == other.x && y == other.y;
-        }
-    };
+    using TileKey = ::TileKey;
 
     explicit WSIView(QWidget* parent = nullptr);
      ~WSIView() override;
@@ -39,8 +39,18 @@ public:
     void resetView();
 
     bool isEmpty() const;
-    void setDetections(const QVector<DetBox>& boxes);
-    QImage grabViewportImage() const;
+    // 结果按值共享，不复制框数据。空间索引与 LOD 在线程池中建好后才替换显示的结果；
+    // 构建期间到来的更新合并为一次，建完后再建最新的那份
+    void setDetections(const DetectionResult& result);
+    // 当前显示（索引已建好）的结果，detectionAt 的下标以它为准
+    const DetectionResult& detections() const { return m_detections; }
+    // 热力图叠加层：按需在后台构建，与检测结果、切片尺寸绑定
+    void setHeatmapVisible(bool visible);
+    bool isHeatmapVisible() const { return m_heatmapVisible; }
+    void setHeatmapOpacity(double opacity);
+    double heatmapOpacity() const { return m_heatmapOpacity; }
+    // 视图坐标处的检测框下标（对应 detections() 的顺序），没有返回 -1
+    int detectionAt(const QPointF& viewPos) const;
 
     int levelCount() const { return m_levelCount; }
     int currentLevel() const { return m_currentLevel; }
@@ -56,6 +66,8 @@ signals:
     void viewportChanged();
     void levelChanged(int level);
     void miniMapReady(const QImage& image, double downsample, const QSize& level0Size);
+    // 单击（未拖动）落在检测框上时发出
+    void detectionClicked(int index);
 
 protected:
     void paintEvent(QPaintEvent* event) override;
@@ -64,21 +76,35 @@ protected:
     void mouseMoveEvent(QMouseEvent* event) override;
     void mouseReleaseEvent(QMouseEvent* event) override;
     void resizeEvent(QResizeEvent* event) override;
+    void changeEvent(QEvent* event) override;
 
 private:
-    void touchTile(const TileKey& key);
-    void pruneCache();
     void fitToWindow();
     void clampWorldTopLeft();
     QRectF currentWorldRect() const;
     int chooseLevel(double viewScale) const;
     void scheduleRepaint(bool force = false);
     void updateVisibleTiles(bool forceRequest);
-    void requestTile(const TileKey& key, int tileW, int tileH);
+    void enqueueTiles(int level, const QRectF& worldRect);
+    double tilePriority(const TileKey& key) const;
+    QRectF predictedWorldRect() const;
+    int zoomTargetLevel() const;
+    void dispatchTiles(const QVector<TileScheduler::Request>& batch);
+    void watchTile(const TileKey& key, const QFuture<QImage>& future);
+    void drawTile(QPainter& painter, const TileKey& key, const QImage& tile, const QRectF& destRect, double factor);
+    void requestScaledTile(const TileKey& key, const QImage& tile, const QSize& size);
     void cancelPendingFetches();
     QRectF worldToScreen(const QRectF& rect) const;
     void drawDetections(QPainter& painter);
+    void drawDetectionBoxes(QPainter& painter);
+    void drawDetectionClusters(QPainter& painter, const QRectF& visibleWorld);
+    void drawDetectionDensity(QPainter& painter, const QRectF& visibleWorld);
     void drawLowResPreview(QPainter& painter);
+    void drawHeatmapOverlay(QPainter& painter);
+    void rebuildHeatmap();
+    void rebuildDetectionIndex();
+    bool drawFallbackTile(QPainter& painter, const QRectF& worldRect);
+    bool drawCachedCover(QPainter& painter, int level, const QRectF& worldRect);
     void prepareMiniMap();
 
     WSIHandler* m_handler{nullptr};
@@ -99,23 +125,61 @@ private:
     bool m_isPanning{false};
     QPoint m_lastMousePos;
 
-    QVector<DetBox> m_detectionBoxes;
+    // 预取：拖动速度（world 像素/毫秒，指数平滑）与最近一次滚轮缩放的目标 level
+    QPointF m_panVelocity;
+    QElapsedTimer m_panClock;
+    int m_zoomTarget{-1};
+    QElapsedTimer m_zoomClock;
+    int m_prefetchLookaheadMs{400};
+
+    DetectionResult m_detections;
+    DetectionIndex m_detectionIndex;
+    DetectionLod m_detectionLod;
+    // 等待建索引的最新结果；serial 每次 setDetections 递增，用来丢弃被同步清空取代的构建
+    DetectionResult m_pendingDetections;
+    quint64 m_detectionSerial{0};
+    quint64 m_shownDetectionSerial{0};
+    bool m_detectionsDirty{false};
+    bool m_detectionBuilding{false};
+    QVector<DetectionLod::Cell> m_visibleCells;
+
+    // 标签文字排版缓存，key 为 标签 + 分数（保留两位小数，以百分数取整）
+    struct LabelGlyph {
+        QStaticText text;
+        QSizeF size;
+    };
+    using LabelKey = QPair<QString, int>;
+    const LabelGlyph& labelGlyph(const QString& label, float score, const QFont& font);
+    QHash<LabelKey, LabelGlyph> m_labelCache;
+
+    bool m_heatmapVisible{false};
+    bool m_heatmapDirty{true};
+    double m_heatmapOpacity{0.5};
+    quint64 m_heatmapGeneration{0};
+    bool m_heatmapBuilding{false};      // 同一时间只建一份，期间的变化记为 dirty，建完再补
+    std::shared_ptr<const HeatmapPyramid> m_heatPyramid;
+    QHash<quint64, QImage> m_heatTiles;   // (level, ty, tx) -> 着色后的 tile
+    QVector<int> m_visibleDetections;   // 绘制时复用，避免每帧分配
+    QPoint m_pressPos;
 
     QElapsedTimer m_requestTimer;
     int m_requestIntervalMs{80};
     bool m_pendingRequest{false};
 
-    QHash<TileKey, QImage> m_tileCache;
     QHash<TileKey, QFutureWatcher<QImage>*> m_pendingFetches;
-    QList<TileKey> m_tileLru;
-    QThreadPool m_tileThreadPool;
-    int m_tileCacheCapacity{192};
-    const qint64 m_tileSize{512};
+    TileScheduler m_scheduler;
+    // 当前切片所有视图读取共用；换片或析构时取消。只撤回本视图的等待，
+    // 与其他调用方（区域读取、小地图）共享的 tile 仍会读完
+    CancelToken m_fetchCancel;
+    const qint64 m_tileSize{WSIHandler::kTileSize};
     quint64 m_generation{0};
 
+    // 当前缩放倍率下预缩放好的 tile，缩放稳定后在线程池生成，绘制时直接贴图；倍率变化即清空
+    QHash<TileKey, QImage> m_scaledTiles;
+    QHash<TileKey, QFutureWatcher<QImage>*> m_pendingScales;
+    double m_scaledFactor{0.0};
+
     QImage m_miniMapImage;
     double m_miniMapDownsample{1.0};
     int m_miniMapLevel{-1};
 };
-
-uint qHash(const WSIView::TileKey& key, uint seed = 0) noexcept;